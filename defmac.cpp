@@ -6,16 +6,51 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include <cstring>
 #include <regex>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <csignal>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+#define DEFMAC_POSIX
+#endif
 
 /* *****************************************************************************
  *                                  6 CAVEATS                                 *
  * *****************************************************************************
  * (0) RESERVED CHARS:         '`' & '$'                                      *
  * (1) BLIND TO BOUNDS:        Will replace string contents matching #defmac  *
+ *                             (unless "-lex": skips comments & literals)     *
  * (2) UNIVERSAL APPLICATION:  #defmac macros applied throughout entire file  *
  * (3) NO RECURSION:           Nested #defmac instances = undefn behavior     *
  * (4) SEQUENTIALLY PROCESSED: Order overlapping #defmac defns top-down by    *
@@ -23,11 +58,25 @@
  * (5) DISTRIBUTED TYPE CAST:  Type-distributed casting via $<type>vars casts *
  *                             all $vars instances,& type MUST != a macro arg *
  * *****************************************************************************
- *                              3 CMD-LINE FLAGS                              *
+ *                             11 CMD-LINE FLAGS                              *
  * *****************************************************************************
  * (0) -l     // Show info flag                                               *
  * (1) -local // Change local file - ie do NOT generate a new file            *
- * (2) -o     // Next string = filename for generated file                    *
+ * (2) -o     // Next string = filename for generated file (batch: directory) *
+ * (3) -cache // Reuse compiled #defmac_include files ($DEFMAC_CACHE_DIR)     *
+ * (4) -j     // Next number = worker threads, for a batch or 1 big file      *
+ * (5) -lex   // Lexer-aware: never match in comments or string/char literals *
+ * (6) -stream // Map in bounded memory (-span N: longest multi-line match)   *
+ * (7) -prof  // Per-macro cost report (-prof-json FILE: as JSON, to FILE)    *
+ * (8) -if-changed // Only rewrite outputs whose bytes change (keeps mtimes)  *
+ * (9) -MD    // Also write make deps to <output>.d (-MF FILE: to FILE)       *
+ * (10) -max-steps // Next number = steps 1 match attempt may take (over it:  *
+ *                 // skipped & reported); -max-seconds: caps 1 file's time   *
+ * => >1 files, directories, &/or "@fileList"s == map all as 1 parallel batch *
+ * => --serve  == daemon keeping compiled #defmac_include's ($DEFMAC_SOCKET)  *
+ * => --client == map via that daemon (same flags; maps locally if it's down) *
+ * => --watch  == re-map 1 file on every save, re-mapping only edited lines   *
+ * => --emit-matcher == compile 1 file's #defmacs to a constexpr C++ header   *
  * *****************************************************************************
  *                            ABOUT #defmac MACROS                            *
  * *****************************************************************************
@@ -55,6 +104,9 @@
  * (0) #defmac_include `someFile.someExtension`                               *
  *     => Parses & stores #defmac instances within "someFile.someExtension"   *
  * (1) To consolidate #defmac's for multiple files in only 1 place            *
+ * (2) Only its directives are read (its code is never mapped): each path is  *
+ *     compiled once per file parsed, sibling includes concurrently, & an     *
+ *     include cycle is an error                                              *
  * *****************************************************************************
  *                BEYOND #defmac: DIRECTLY ACCESSING THE PARSER               *
  * *****************************************************************************
@@ -75,13 +127,1460 @@
  *                                                                            *
  * (3) Header Consolidation:                                                  *
  *     => Cluster all #include's to the top of a string, systems above locals *
+ *        (each once, in the order first seen)                                *
  *     => string newBuffer = obj.cluster_buffer_headers(oldBuffer);           *
  *                                                                            *
  * (4) Map A File With Prefixes, Aliases, & Any #defmac Macros W/in:          *
  *     => obj.map_file(old_filename, new_mapped_filename);                    *
  *     => Look at DEF_MAC::Script's public members for more!                  *
+ *                                                                            *
+ * (5) Macro Sets Fixed At Build Time:                                        *
+ *     => "defmac --emit-matcher macros.dmac" writes macros_DMAC.hpp: each    *
+ *        #defmac's compiled matcher as constexpr data (namespace "macros")   *
+ *     => #define DEFMAC_NO_MAIN, #include "defmac.cpp" & "macros_DMAC.hpp",  *
+ *        then obj.push_static_macros(macros::macros); (no runtime parse)     *
  * ****************************************************************************/
 
+/******************************************************************************
+* VECTORIZED SEARCH: LITERALS & BYTE SETS (SSE2/AVX2, PICKED AT RUNTIME)
+******************************************************************************/
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define DEFMAC_X86_SIMD
+#endif
+
+namespace DEF_MAC {
+  // Widest search this CPU runs ("scalar" == std::string_view's own finds)
+  enum class SimdLevel : unsigned char {scalar, sse2, avx2};
+
+  inline const char *simd_level_name(SimdLevel level) {
+    return level == SimdLevel::avx2 ? "avx2" : level == SimdLevel::sse2 ? "sse2" : "scalar";
+  }
+
+  // What the CPU supports, capped by $DEFMAC_SIMD ("scalar"/"sse2", ie to compare)
+  inline SimdLevel detected_simd_level() {
+    SimdLevel level = SimdLevel::scalar;
+#ifdef DEFMAC_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))      level = SimdLevel::avx2;
+    else if(__builtin_cpu_supports("sse2")) level = SimdLevel::sse2;
+#endif
+    if(const char *cap = std::getenv("DEFMAC_SIMD")) {
+      const std::string_view wanted(cap);
+      if(wanted == "scalar") level = SimdLevel::scalar;
+      else if(wanted == "sse2" && level == SimdLevel::avx2) level = SimdLevel::sse2;
+    }
+    return level;
+  }
+
+  // The level every search runs at (lower it before mapping, never raise it)
+  inline SimdLevel &simd_level() {
+    static SimdLevel level = detected_simd_level();
+    return level;
+  }
+
+  // How common byte "c" is in C++ source (0 == rare): picks the literal bytes a
+  // vector search filters on, since each filter hit costs a full comparison
+  inline unsigned source_byte_rank(char c) {
+    if(c == ' ' || c == '\t' || c == '\n' || c == '\r') return 3;
+    if(std::islower(static_cast<unsigned char>(c)) || std::isdigit(static_cast<unsigned char>(c))) return 2;
+    if(std::isupper(static_cast<unsigned char>(c)) || std::string_view("_;,()=").find(c) != std::string_view::npos) return 1;
+    return 0;
+  }
+
+#ifdef DEFMAC_X86_SIMD
+  // Literal search: 2 of its bytes ("lit[i]" & "lit[j]", i < j) compared at 16/32
+  // starts per step, only starts matching both get memcmp'd (the rest of "text"
+  // past "p" is left to the caller)
+  __attribute__((target("sse2")))
+  inline std::size_t find_literal_sse2(std::string_view text, std::string_view lit, std::size_t i, std::size_t j, std::size_t &p) {
+    const __m128i at_i = _mm_set1_epi8(lit[i]), at_j = _mm_set1_epi8(lit[j]);
+    for(; p + j + 16 <= text.size(); p += 16) {
+      const __m128i block_i = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + p + i));
+      const __m128i block_j = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + p + j));
+      for(unsigned hits = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_i, at_i), _mm_cmpeq_epi8(block_j, at_j)))); hits; hits &= hits-1) {
+        const std::size_t s = p + __builtin_ctz(hits);
+        if(s + lit.size() <= text.size() && std::memcmp(text.data() + s, lit.data(), lit.size()) == 0) return s;
+      }
+    }
+    return std::string_view::npos;
+  }
+  __attribute__((target("avx2")))
+  inline std::size_t find_literal_avx2(std::string_view text, std::string_view lit, std::size_t i, std::size_t j, std::size_t &p) {
+    const __m256i at_i = _mm256_set1_epi8(lit[i]), at_j = _mm256_set1_epi8(lit[j]);
+    const char *at = text.data();
+    #define DEFMAC_AVX2_HITS(q) _mm256_and_si256(                                                                \
+      _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(at + (q) + i)), at_i), \
+      _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(at + (q) + j)), at_j))
+    for(; p + j + 32 <= text.size(); p += 32) {
+      const __m256i hits = DEFMAC_AVX2_HITS(p);
+      if(p + j + 64 <= text.size()) { // 64 starts per test while nothing hits
+        const __m256i either = _mm256_or_si256(hits, DEFMAC_AVX2_HITS(p+32));
+        if(_mm256_testz_si256(either, either)) {
+          p += 32;
+          continue;
+        }
+      }
+      for(unsigned mask = unsigned(_mm256_movemask_epi8(hits)); mask; mask &= mask-1) {
+        const std::size_t s = p + __builtin_ctz(mask);
+        if(s + lit.size() <= text.size() && std::memcmp(text.data() + s, lit.data(), lit.size()) == 0) return s;
+      }
+    }
+    #undef DEFMAC_AVX2_HITS
+    return std::string_view::npos;
+  }
+#endif
+
+  // 1st "lit" in "text" at/after "from" (npos if none), as std::string_view::find
+  // => a literal led by a rare byte is left to memchr (already vectorized by libc)
+  inline std::size_t find_literal(std::string_view text, std::string_view lit, std::size_t from = 0) {
+    if(lit.size() < 2 || from >= text.size() || !source_byte_rank(lit[0])) return text.find(lit, from);
+#ifdef DEFMAC_X86_SIMD
+    const SimdLevel level = simd_level();
+    if(level != SimdLevel::scalar) {
+      std::size_t i = 0, j = 1; // the 2 rarest bytes (distinct positions)
+      for(std::size_t k = 1; k < lit.size(); ++k)
+        if(source_byte_rank(lit[k]) < source_byte_rank(lit[i])) j = i, i = k;
+        else if(k != i && (j == i || source_byte_rank(lit[k]) < source_byte_rank(lit[j]))) j = k;
+      if(i > j) std::swap(i, j);
+      const std::size_t found = level == SimdLevel::avx2 ? find_literal_avx2(text, lit, i, j, from) : find_literal_sse2(text, lit, i, j, from);
+      if(found != std::string_view::npos) return found;
+    }
+#endif
+    return text.find(lit, from); // (the last < 1 vector's worth)
+  }
+
+
+  // A set of bytes to find the 1st of (ie '`' & '\r'): SSE2 compares each of up
+  // to 8 members, AVX2 looks any set up by nibble (2 shuffles per 32 bytes)
+  class ByteSet {
+    std::string   bytes;
+    bool          member[256] = {};
+    unsigned char nibble_rows[2][16] = {}; // [high nibble >= 8][low nibble]: bit (high nibble & 7) per member
+
+    std::size_t find_scalar(std::string_view text, std::size_t p) const {
+      while(p < text.size() && !member[static_cast<unsigned char>(text[p])]) ++p;
+      return p < text.size() ? p : std::string_view::npos;
+    }
+#ifdef DEFMAC_X86_SIMD
+    __attribute__((target("sse2")))
+    std::size_t find_sse2(std::string_view text, std::size_t &p) const {
+      __m128i wanted[8];
+      for(std::size_t i = 0; i < bytes.size(); ++i) wanted[i] = _mm_set1_epi8(bytes[i]);
+      for(; p + 16 <= text.size(); p += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + p));
+        __m128i hits = _mm_cmpeq_epi8(block, wanted[0]);
+        for(std::size_t i = 1; i < bytes.size(); ++i) hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, wanted[i]));
+        if(const int mask = _mm_movemask_epi8(hits)) return p + __builtin_ctz(unsigned(mask));
+      }
+      return std::string_view::npos;
+    }
+    __attribute__((target("avx2")))
+    std::size_t find_avx2(std::string_view text, std::size_t &p) const {
+      const __m256i low_rows  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibble_rows[0])));
+      const __m256i high_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibble_rows[1])));
+      const __m256i bits      = _mm256_setr_epi8(1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128);
+      const __m256i nibble    = _mm256_set1_epi8(0x0f);
+      for(; p + 32 <= text.size(); p += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text.data() + p));
+        const __m256i low   = _mm256_and_si256(block, nibble);
+        const __m256i high  = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+        // row by the low nibble (bytes >= 0x80 use the 2nd table), column bit by the high one
+        const __m256i row   = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, low), _mm256_shuffle_epi8(high_rows, low), block);
+        const __m256i miss  = _mm256_cmpeq_epi8(_mm256_and_si256(row, _mm256_shuffle_epi8(bits, high)), _mm256_setzero_si256());
+        if(const unsigned mask = ~unsigned(_mm256_movemask_epi8(miss))) return p + __builtin_ctz(mask);
+      }
+      return std::string_view::npos;
+    }
+#endif
+
+  public:
+    ByteSet() = default;
+    explicit ByteSet(std::string_view set) {
+      for(unsigned char c : set) {
+        if(member[c]) continue;
+        member[c] = true;
+        bytes += char(c);
+        nibble_rows[c >> 7][c & 15] |= static_cast<unsigned char>(1u << ((c >> 4) & 7));
+      }
+    }
+
+    bool        contains(char c) const {return member[static_cast<unsigned char>(c)];}
+    std::size_t size()           const {return bytes.size();}
+
+    // 1st member in "text" at/after "from" (npos if none), as std::string_view::find_first_of
+    std::size_t find(std::string_view text, std::size_t from = 0) const {
+      if(bytes.empty() || from >= text.size()) return std::string_view::npos;
+      if(bytes.size() == 1) return text.find(bytes[0], from);
+#ifdef DEFMAC_X86_SIMD
+      const SimdLevel level = simd_level();
+      std::size_t found = std::string_view::npos;
+      if(level == SimdLevel::avx2) found = find_avx2(text, from);
+      else if(level == SimdLevel::sse2 && bytes.size() <= 8) found = find_sse2(text, from);
+      if(found != std::string_view::npos) return found;
+#endif
+      return find_scalar(text, from);
+    }
+  };
+};  // end of namespace DEF_MAC
+
+/******************************************************************************
+* HEAP ALLOCATION COUNTS: CHECKS MAPPING STAYS OFF THE HEAP PER MATCH (-prof)
+******************************************************************************/
+
+// Opt-in (ie defmac_bench.cpp): replacing the global "operator new" would clash
+// w/ any program bringing its own allocator hooks, so it's off by default
+namespace DEF_MAC {
+#ifdef DEFMAC_COUNT_ALLOCATIONS
+  constexpr bool counts_allocations = true;
+#else
+  constexpr bool counts_allocations = false; // (-prof reports allocations as n/a)
+#endif
+
+  // This thread's heap allocations so far: counted by the "operator new"s below
+  // w/ DEFMAC_COUNT_ALLOCATIONS defined, else always 0
+  inline std::uint64_t &thread_allocations() {
+    static thread_local std::uint64_t count = 0;
+    return count;
+  }
+};  // end of namespace DEF_MAC
+
+#ifdef DEFMAC_COUNT_ALLOCATIONS
+#if defined(__GNUC__) && !defined(__clang__) // (GCC flags the "free" below once it inlines these deletes)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void *operator new(std::size_t size) {
+  ++DEF_MAC::thread_allocations();
+  if(void *block = std::malloc(size ? size : 1)) return block;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) {return ::operator new(size);}
+void operator delete(void *block) noexcept                {std::free(block);}
+void operator delete[](void *block) noexcept              {std::free(block);}
+void operator delete(void *block, std::size_t) noexcept   {::operator delete(block);}
+void operator delete[](void *block, std::size_t) noexcept {::operator delete(block);}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+/******************************************************************************
+* #defmac MATCHER: SYNTAX DEFNS COMPILED TO A COMPACT LINEAR-TIME PROGRAM
+******************************************************************************/
+
+namespace DEF_MAC {
+  // Bumped whenever compiled macro sets (& so cached ".dmac" files) change meaning
+  constexpr const char *VERSION = "1.1.0";
+
+  // 64-bit FNV-1a: keys cached macro sets by their source's content
+  inline std::uint64_t content_hash(std::string_view bytes) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for(unsigned char c : bytes) hash = (hash ^ c) * 1099511628211ull;
+    return hash;
+  }
+
+  // Native-endian binary (de)serialization for cached macro sets
+  struct ByteWriter {
+    std::string bytes;
+    template <typename T> void put(T value) {bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));}
+    void put_str(std::string_view str) {put(std::uint32_t(str.size())), bytes.append(str.data(), str.size());}
+  };
+  struct ByteReader {
+    std::string_view bytes;
+    bool ok = true;
+    template <typename T> T get() {
+      T value{};
+      if(bytes.size() < sizeof(T)) return ok = false, value;
+      std::copy(bytes.data(), bytes.data() + sizeof(T), reinterpret_cast<char *>(&value));
+      bytes.remove_prefix(sizeof(T));
+      return value;
+    }
+    std::uint32_t get_count() { // element count, each element taking >= 1 byte
+      const auto count = get<std::uint32_t>();
+      if(count > bytes.size()) return ok = false, 0;
+      return count;
+    }
+    std::string get_str() {
+      const auto size = get<std::uint32_t>();
+      if(!ok || bytes.size() < size) return ok = false, std::string();
+      std::string str(bytes.substr(0, size));
+      bytes.remove_prefix(size);
+      return str;
+    }
+  };
+
+  // C++ source for a constexpr std::string_view of "bytes" (ie emitted matchers):
+  // octal escapes (always 3 digits) keep any byte, incl. '\0', exact
+  inline std::string string_view_source(std::string_view bytes) {
+    std::string source = "std::string_view(\"";
+    for(unsigned char c : bytes) {
+      if(c == '\\' || c == '"') source += '\\', source += char(c);
+      else if(c >= ' ' && c <= '~' && c != '?') source += char(c); // ('?': no "??" trigraphs pre-C++17)
+      else source += {'\\', char('0' + (c >> 6)), char('0' + ((c >> 3) & 7)), char('0' + (c & 7))};
+    }
+    return source + "\", " + std::to_string(bytes.size()) + ")";
+  }
+
+  // C++-aware split of a buffer into code & the [begin,end) spans it must never
+  // match w/in: comments, string & char literals, & raw strings (1 linear pass)
+  class CodeMap {
+  public:
+    enum class Kind : unsigned char {comment, string, character, raw_string};
+    struct Span {
+      std::size_t begin, end;
+      Kind        kind;
+    };
+
+  private:
+    std::vector<Span> spans; // sorted & disjoint
+
+    static bool is_word(char c) {return std::isalnum(static_cast<unsigned char>(c)) || c == '_';}
+
+    // end of the quoted literal opening at "p" (stops at an unescaped newline if unterminated)
+    static std::size_t quoted_end(std::string_view text, std::size_t p) {
+      const char quote = text[p];
+      for(++p; p < text.size(); ++p) {
+        if(text[p] == '\\') ++p;
+        else if(text[p] == quote) return p+1;
+        else if(text[p] == '\n') return p;
+      }
+      return text.size();
+    }
+
+  public:
+    static CodeMap lex(std::string_view text) {
+      CodeMap map;
+      const std::size_t n = text.size();
+      for(std::size_t p = 0; p < n;) {
+        const char c = text[p];
+        if(c == '/' && p+1 < n && text[p+1] == '/') {        // line comment (w/ '\' continuations)
+          std::size_t e = p+2;
+          while(e < n && !(text[e] == '\n' && text[e-1] != '\\' && !(text[e-1] == '\r' && text[e-2] == '\\'))) ++e;
+          map.spans.push_back(Span{p, e, Kind::comment});
+          p = e;
+        } else if(c == '/' && p+1 < n && text[p+1] == '*') { // block comment
+          const std::size_t close = text.find("*/", p+2);
+          const std::size_t e = close == std::string_view::npos ? n : close+2;
+          map.spans.push_back(Span{p, e, Kind::comment});
+          p = e;
+        } else if(c == '"' || c == '\'') {
+          const std::size_t e = quoted_end(text, p);
+          map.spans.push_back(Span{p, e, c == '"' ? Kind::string : Kind::character});
+          p = e;
+        } else if(std::isdigit(static_cast<unsigned char>(c))) { // pp-number: skips 1'000 digit separators
+          for(++p; p < n; ++p) {
+            if((text[p] == '+' || text[p] == '-') && std::string_view("eEpP").find(text[p-1]) != std::string_view::npos) continue;
+            if(!is_word(text[p]) && text[p] != '.' && !(text[p] == '\'' && p+1 < n && is_word(text[p+1]))) break;
+          }
+        } else if(is_word(c)) {                              // identifier, or an encoding/raw prefix
+          std::size_t e = p;
+          while(e < n && is_word(text[e])) ++e;
+          const std::string_view word = text.substr(p, e-p);
+          if(e < n && text[e] == '"' && (word == "R" || word == "u8R" || word == "uR" || word == "UR" || word == "LR")) {
+            const std::size_t open = text.find('(', e+1);
+            std::size_t close = std::string_view::npos;
+            if(open != std::string_view::npos && open-e-1 <= 16) // R"delim( ... )delim"
+              close = text.find(")" + std::string(text.substr(e+1, open-e-1)) + "\"", open);
+            const std::size_t end = close == std::string_view::npos ? n : close + (open-e-1) + 2;
+            map.spans.push_back(Span{e, end, Kind::raw_string});
+            p = end;
+          } else {
+            p = e; // any "u8"/"L"/... prefix stays code, its literal is lexed next
+          }
+        } else {
+          ++p;
+        }
+      }
+      return map;
+    }
+
+    const std::vector<Span> &skipped() const {return spans;}
+
+    // No comment or literal overlaps [begin,end) (or contains "begin" if empty)
+    bool is_code(std::size_t begin, std::size_t end) const {
+      auto after = std::upper_bound(spans.begin(), spans.end(), begin, 
+        [](std::size_t p, const Span &span) {return p < span.end;}); // 1st span ending after "begin"
+      return after == spans.end() || after->begin >= std::max(end, begin+1);
+    }
+
+    // 1st code position >= "p"
+    std::size_t code_from(std::size_t p) const {
+      auto after = std::upper_bound(spans.begin(), spans.end(), p, 
+        [](std::size_t q, const Span &span) {return q < span.end;});
+      return (after != spans.end() && after->begin <= p) ? after->end : p;
+    }
+  };
+
+
+#ifdef DEFMAC_POSIX
+  // Read-only view of a whole file via mmap (no copy into user space)
+  class MappedFile {
+    void       *data = nullptr;
+    std::size_t size = 0;
+    bool        open = false;
+  public:
+    explicit MappedFile(const std::string &filename) {
+      const int fd = ::open(filename.c_str(), O_RDONLY);
+      if(fd < 0) return;
+      struct stat info;
+      if(::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        size = std::size_t(info.st_size);
+        data = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        open = !size || data != MAP_FAILED;
+        if(data == MAP_FAILED) data = nullptr, size = 0;
+      }
+      ::close(fd);
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {if(data) ::munmap(data, size);}
+    bool is_open() const {return open;}
+    std::string_view view() const {return std::string_view(static_cast<const char *>(data), size);}
+  };
+
+  // Writes a list of views w/ as few writev calls as possible (IOV_MAX per call)
+  inline bool write_gathered(int fd, const std::vector<std::string_view> &pieces) {
+    std::vector<iovec> iov;
+    iov.reserve(pieces.size());
+    for(auto piece : pieces)
+      if(!piece.empty()) iov.push_back(iovec{const_cast<char *>(piece.data()), piece.size()});
+    for(std::size_t first = 0; first < iov.size();) {
+      const auto n = ::writev(fd, iov.data() + first, int(std::min<std::size_t>(iov.size() - first, IOV_MAX)));
+      if(n < 0 && errno == EINTR) continue;
+      if(n <= 0) return false;
+      std::size_t written = std::size_t(n);
+      for(; first < iov.size() && written >= iov[first].iov_len; ++first) written -= iov[first].iov_len;
+      if(written) { // partial write: resume mid-piece
+        iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+        iov[first].iov_len -= written;
+      }
+    }
+    return true;
+  }
+#endif
+
+  // Whether file "filename" already holds exactly "pieces" (concatenated), read
+  // in chunks: a writer can then skip rewriting it, leaving its mtime (& so any
+  // build step depending on it) untouched
+  inline bool file_holds(const std::string &filename, const std::vector<std::string_view> &pieces) {
+    std::error_code ec;
+    std::uintmax_t size = 0;
+    for(auto piece : pieces) size += piece.size();
+    const std::uintmax_t held = std::filesystem::file_size(filename, ec);
+    if(ec || held != size) return false;
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    std::string chunk;
+    for(auto piece : pieces)
+      for(std::size_t p = 0; p < piece.size(); p += chunk.size()) {
+        chunk.resize(std::min<std::size_t>(piece.size() - p, 1 << 16));
+        if(!file.read(&chunk[0], chunk.size()) || piece.compare(p, chunk.size(), chunk) != 0) return false;
+      }
+    return bool(file);
+  }
+
+  // Whether files "a" & "b" hold the same bytes (ie a temp output & the file it'd replace)
+  inline bool files_match(const std::string &a, const std::string &b) {
+    std::error_code ec_a, ec_b;
+    const std::uintmax_t size = std::filesystem::file_size(a, ec_a);
+    if(ec_a || size != std::filesystem::file_size(b, ec_b) || ec_b) return false;
+    std::ifstream file_a(a.c_str(), std::ios::binary), file_b(b.c_str(), std::ios::binary);
+    std::string chunk_a(1 << 16, '\0'), chunk_b(chunk_a);
+    for(std::uintmax_t left = size; left;) {
+      const std::size_t n = std::size_t(std::min<std::uintmax_t>(left, chunk_a.size()));
+      if(!file_a.read(&chunk_a[0], n) || !file_b.read(&chunk_b[0], n) || std::memcmp(chunk_a.data(), chunk_b.data(), n) != 0) return false;
+      left -= n;
+    }
+    return file_a.is_open() && file_b.is_open();
+  }
+
+  // Whether paths "a" & "b" name the same file (ie "./a.cpp" & "a.cpp", or a link
+  // to it): writing 1 must then go via a temp file, not truncate the other's bytes
+  inline bool same_file(const std::string &a, const std::string &b) {
+    std::error_code ec;
+    return a == b || std::filesystem::equivalent(a, b, ec);
+  }
+
+
+  // A #defmac syntax compiled to literal segments & $var holes, matching w/ the
+  // same semantics as its regex form (see "regex_source()"):
+  //   => 1st $var (if it starts the defn) == ((\S)+) : greedy, non-space chars
+  //   => lst $var (if it ends the defn)   == ((\S)+) : greedy, non-space chars
+  //   => any other $var                   == ((.)+?) : lazy, w/in 1 line
+  //   => repeated $var                    == \{n}    : backtraces 1st instance
+  // Backreference-free programs match via a lazily built tagged DFA (see
+  // "TaggedDfa"), falling back on backtracking (w/ failed hole states memoized,
+  // so a scan visits each (hole, position) pair at most once) if it outgrows its
+  // state cap. Programs w/ backreferences always backtrack
+  class MacroProgram {
+  public:
+    enum class Op : unsigned char {literal, lazy_hole, lead_hole, trail_hole, backref};
+    struct Instr {
+      Op       op;
+      unsigned arg;  // literal index OR capture slot
+      unsigned memo; // row in the failed-state memo (lazy holes only)
+    };
+
+    struct Match {
+      std::size_t begin = 0, end = 0;
+      std::vector<std::pair<std::size_t,std::size_t>> captures; // [begin,end) per $var slot
+      std::string_view str(std::string_view text, std::size_t slot) const {
+        return text.substr(captures[slot].first, captures[slot].second - captures[slot].first);
+      }
+    };
+
+
+  private:
+    std::vector<Instr>       code;
+    std::vector<std::string> literals;
+    std::vector<std::string> variables;     // distinct $var names, by capture slot
+    unsigned                 memo_rows = 0; // # of lazy holes
+    bool                     backrefs  = false;
+
+    static bool is_word(char c)    {return std::isalnum(static_cast<unsigned char>(c)) || c == '_';}
+    static bool is_space(char c)   {return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';}
+    static bool is_newline(char c) {return c == '\n' || c == '\r';}
+
+
+  public:
+    // Compile a raw #defmac syntax defn (ie "$base ** $exp")
+    static MacroProgram compile(const std::string &syntax) {
+      MacroProgram prog;
+      std::string literal;
+      auto flush_literal = [&]{
+        if(literal.empty()) return;
+        prog.code.push_back(Instr{Op::literal, unsigned(prog.literals.size()), 0});
+        prog.literals.push_back(literal);
+        literal.clear();
+      };
+
+      for(std::size_t i = 0; i < syntax.size();) {
+        if(syntax[i] != '$' || i+1 == syntax.size() || !is_word(syntax[i+1])) {
+          literal += syntax[i++];
+          continue;
+        }
+        std::size_t token_end = i+1;
+        while(token_end < syntax.size() && is_word(syntax[token_end])) ++token_end;
+        const std::string token = syntax.substr(i, token_end-i);
+        flush_literal();
+        auto seen = std::find(prog.variables.begin(), prog.variables.end(), token);
+        if(seen != prog.variables.end()) {
+          prog.code.push_back(Instr{Op::backref, unsigned(seen - prog.variables.begin()), 0});
+          prog.backrefs = true;
+        } else {
+          prog.code.push_back(Instr{Op::lazy_hole, unsigned(prog.variables.size()), 0});
+          prog.variables.push_back(token);
+        }
+        i = token_end;
+      }
+      flush_literal();
+
+      // var token ending/starting the defn only scrapes NON-SPACE-CHARs
+      if(!prog.code.empty() && prog.code.back().op == Op::lazy_hole)  prog.code.back().op  = Op::trail_hole;
+      if(!prog.code.empty() && prog.code.front().op == Op::lazy_hole) prog.code.front().op = Op::lead_hole;
+      for(auto &in : prog.code)
+        if(in.op == Op::lazy_hole) in.memo = prog.memo_rows++;
+      return prog;
+    }
+
+
+    bool        empty()            const {return code.empty();}
+    bool        has_backrefs()     const {return backrefs;}
+    // backreference-free programs w/ <= 32 $vars (2 tags each in a 64-bit mask) run as a DFA
+    bool        uses_dfa()         const {return !backrefs && variables.size() <= 32;}
+    const char *engine_name()      const {return uses_dfa() ? "tagged DFA" : "backtracking";}
+    // whether a match may cross a '\n' (only via a literal: $vars never do)
+    bool        spans_lines()      const {
+      return std::any_of(literals.begin(), literals.end(), [](const std::string &lit) {return lit.find('\n') != std::string::npos;});
+    }
+    std::size_t capture_count()    const {return variables.size();}
+    const std::vector<std::string> &variable_names() const {return variables;}
+
+    // The literal every match must contain at a known offset from its start:
+    // the defn's 1st literal, if it starts the defn or directly follows a
+    // leading $var (nullptr if neither, ie "$a$b ...")
+    const std::string *anchor() const {
+      if(code.empty()) return nullptr;
+      if(code[0].op == Op::literal) return &literals[code[0].arg];
+      if(code[0].op == Op::lead_hole && code.size() > 1 && code[1].op == Op::literal) return &literals[code[1].arg];
+      return nullptr;
+    }
+
+
+    // (De)serialize the compiled program for cached macro sets
+    void serialize(ByteWriter &out) const {
+      out.put(std::uint32_t(code.size()));
+      for(auto in : code) out.put(std::uint8_t(in.op)), out.put(std::uint32_t(in.arg)), out.put(std::uint32_t(in.memo));
+      out.put(std::uint32_t(literals.size()));
+      for(auto &lit : literals) out.put_str(lit);
+      out.put(std::uint32_t(variables.size()));
+      for(auto &var : variables) out.put_str(var);
+      out.put(std::uint32_t(memo_rows)), out.put(std::uint8_t(backrefs));
+    }
+    static bool deserialize(ByteReader &in, MacroProgram &prog) {
+      prog = MacroProgram();
+      prog.code.resize(in.get_count());
+      for(auto &instr : prog.code) {
+        instr.op   = Op(in.get<std::uint8_t>());
+        instr.arg  = in.get<std::uint32_t>();
+        instr.memo = in.get<std::uint32_t>();
+      }
+      prog.literals.resize(in.get_count());
+      for(auto &lit : prog.literals) lit = in.get_str();
+      prog.variables.resize(in.get_count());
+      for(auto &var : prog.variables) var = in.get_str();
+      prog.memo_rows = in.get<std::uint32_t>();
+      prog.backrefs  = in.get<std::uint8_t>();
+      for(auto instr : prog.code) // reject corrupt programs rather than index out of bounds
+        if(instr.op > Op::backref || (instr.op == Op::literal ? instr.arg >= prog.literals.size() : instr.arg >= prog.variables.size())
+           || (instr.op == Op::lazy_hole && instr.memo >= prog.memo_rows))
+          in.ok = false;
+      return in.ok;
+    }
+
+
+    // A program compiled ahead of time (by "defmac --emit-matcher") as constexpr data
+    struct Static {
+      const Instr            *code;
+      std::size_t             code_size;
+      const std::string_view *literals;
+      std::size_t             literal_count;
+      const std::string_view *variables;
+      std::size_t             variable_count;
+      unsigned                memo_rows;
+      bool                    backrefs;
+    };
+    static MacroProgram from_static(const Static &data) {
+      MacroProgram prog;
+      prog.code.assign(data.code, data.code + data.code_size);
+      prog.literals.assign(data.literals, data.literals + data.literal_count);
+      prog.variables.assign(data.variables, data.variables + data.variable_count);
+      prog.memo_rows = data.memo_rows;
+      prog.backrefs  = data.backrefs;
+      return prog;
+    }
+    // Write this program's constexpr arrays as "<name>_code" etc, returning its "Static" initializer
+    std::string emit_static(std::ostream &out, const std::string &name) const {
+      static const char *op_names[] = {"literal", "lazy_hole", "lead_hole", "trail_hole", "backref"};
+      out << "  inline constexpr DEF_MAC::MacroProgram::Instr " << name << "_code[] = {";
+      for(std::size_t i = 0; i < code.size(); ++i)
+        out << (i ? ", " : "") << "{DEF_MAC::MacroProgram::Op::" << op_names[unsigned(code[i].op)] << ", " << code[i].arg << ", " << code[i].memo << '}';
+      out << "};\n";
+      auto emit_views = [&](const char *suffix, const std::vector<std::string> &views) -> std::string {
+        if(views.empty()) return "nullptr, 0";
+        out << "  inline constexpr std::string_view " << name << suffix << "[] = {";
+        for(std::size_t i = 0; i < views.size(); ++i) out << (i ? ", " : "") << string_view_source(views[i]);
+        out << "};\n";
+        return name + suffix + ", " + std::to_string(views.size());
+      };
+      const std::string literal_views = emit_views("_literals", literals), variable_views = emit_views("_variables", variables);
+      return "{" + name + "_code, " + std::to_string(code.size()) + ", " + literal_views + ", " + variable_views + ", "
+           + std::to_string(memo_rows) + ", " + (backrefs ? "true" : "false") + "}";
+    }
+
+
+    // Equivalent ECMAScript regex: "$var" in slot {n} == groups 2n+1 (value) & 2n+2
+    std::string regex_source() const {
+      static const std::string regex_control_chars(R"(\^$.*+?()[]{}|)");
+      std::string source;
+      for(auto in : code)
+        switch(in.op) {
+          case Op::literal:
+            for(char c : literals[in.arg]) {
+              if(regex_control_chars.find(c) != std::string::npos) source += '\\';
+              source += c;
+            }
+            break;
+          case Op::lazy_hole:  source += R"(((.)+?))"; break;
+          case Op::lead_hole:
+          case Op::trail_hole: source += R"(((\S)+))"; break;
+          case Op::backref:    source += '\\' + std::to_string(2*in.arg+1); break;
+        }
+      return source;
+    }
+
+
+    // The #defmac syntax compiled (ie "$base ** $exp")
+    std::string syntax_source() const {
+      std::string source;
+      for(auto in : code) source += in.op == Op::literal ? literals[in.arg] : variables[in.arg];
+      return source;
+    }
+
+
+    // Lazily built tagged DFA matching a backreference-free program from 1 start:
+    // each state is the priority-ordered list of NFA threads (1 consuming item
+    // each: a literal byte or a $var's next char) still pending, exactly the
+    // alternatives a backtracker would have left to try, so the 1st thread to
+    // reach the end wins & cuts every thread behind it (leftmost-first, like
+    // ECMAScript). Each transition also records how each next thread's tags
+    // (its $vars' [begin,end) so far) derive from the thread it came from
+    // => bytes are mapped to classes (each literal byte, else space/newline/other),
+    //    doubled by whether the byte is code (literals only match code w/ "-lex")
+    class TaggedDfa {
+      struct Item {
+        char     byte   = 0;     // literal byte (if !hole)
+        bool     hole   = false;
+        bool     greedy = false; // (edge $vars)
+        unsigned slot   = 0;     // capture slot (if hole)
+      };
+      struct Thread {
+        unsigned      src;  // thread index in the previous state (npos: a fresh start)
+        std::uint64_t tags; // tags set to the current position: bit 2n == $var n's begin, 2n+1 == its end
+      };
+      struct Transition {
+        int           next = -1;        // state id (-1 == not built yet)
+        unsigned      first = 0, count = 0; // "plans" span: parallel to the next state's threads
+        unsigned      match_src = npos;  // thread reaching the end this step (if any)
+        std::uint64_t match_tags = 0;
+      };
+      struct Closure { // a state being built
+        std::vector<unsigned> items;
+        std::vector<Thread>   threads;
+        std::vector<bool>     present;
+        bool                  matched = false;
+        unsigned              match_src = npos;
+        std::uint64_t         match_tags = 0;
+      };
+      static constexpr unsigned    npos = ~0u;
+      static constexpr std::size_t max_states = 4096; // past this, fall back on backtracking
+
+      std::vector<Item>                      items;
+      unsigned char                          byte_class[256];
+      std::vector<unsigned char>             class_byte; // a representative byte per class
+      unsigned                               symbols = 0;
+      std::vector<std::vector<unsigned>>     states;
+      std::unordered_map<std::string,int>    state_ids;
+      std::vector<Transition>                transitions; // states x symbols
+      std::vector<Thread>                    plans;       // every transition's threads, back to back
+      std::vector<int>                       packed;      // states x symbols: next state << 1 | matched (-1 == not built yet)
+      Transition                             start;
+      int                                    dead = -1;   // the state w/o threads
+      struct TagEvent {
+        std::uint64_t tags;     // tags set ...
+        std::size_t   position; // ... to this position
+        int           parent;   // the thread's previous event (-1: none)
+      };
+      std::vector<TagEvent>                  tag_log;
+      std::vector<int>                       heads, next_heads; // per thread: its latest event
+      std::vector<std::size_t>               positions;         // per tag: its position in a match
+      // (position, state) pairs w/ no match ahead, direct-mapped by position: a state
+      // fixes its whole future, so later starts reaching 1 stop there (like the
+      // backtracker's memo). Only a match's own path before its end is live, & the
+      // scan never returns before a match's end
+      // (entries of earlier texts are told apart by generation, so a new text clears nothing)
+      struct DeadState {
+        std::size_t   position = 0;
+        int           state = -1;
+        std::uint32_t generation = 0;
+      };
+      static constexpr std::size_t               dead_memo_size = 1 << 16;
+      std::vector<DeadState>                     dead_memo;
+      std::uint32_t                              generation = 0;
+      bool                                   overflowed = false;
+
+      void add(Closure &c, unsigned item, unsigned src, std::uint64_t set) const {
+        if(c.matched || c.present[item]) return; // (a higher-priority thread already holds it)
+        c.present[item] = true;
+        c.items.push_back(item);
+        c.threads.push_back(Thread{src, set});
+      }
+      void enter(Closure &c, unsigned item, unsigned src, std::uint64_t set) const {
+        if(c.matched) return;
+        if(item == items.size()) {
+          c.matched = true, c.match_src = src, c.match_tags = set;
+          return;
+        }
+        if(items[item].hole) set |= std::uint64_t(1) << (2 * items[item].slot);
+        add(c, item, src, set);
+      }
+      // after a $var's char: greedy ones try another char 1st, lazy ones the rest of the defn
+      void after_hole_char(Closure &c, unsigned item, unsigned src) const {
+        const std::uint64_t end = std::uint64_t(1) << (2 * items[item].slot + 1);
+        if(items[item].greedy) add(c, item, src, 0), enter(c, item+1, src, end);
+        else                   enter(c, item+1, src, end), add(c, item, src, 0);
+      }
+
+      int state_id(const std::vector<unsigned> &thread_items) {
+        std::string key(reinterpret_cast<const char *>(thread_items.data()), thread_items.size() * sizeof(unsigned));
+        auto found = state_ids.find(key);
+        if(found != state_ids.end()) return found->second;
+        state_ids.emplace(std::move(key), int(states.size()));
+        states.push_back(thread_items);
+        transitions.resize(states.size() * symbols);
+        packed.resize(states.size() * symbols, -1);
+        return int(states.size()-1);
+      }
+      Transition to_transition(Closure &c) {
+        Transition t;
+        t.next       = state_id(c.items);
+        t.first      = unsigned(plans.size());
+        t.count      = unsigned(c.threads.size());
+        plans.insert(plans.end(), c.threads.begin(), c.threads.end());
+        t.match_src  = c.match_src;
+        t.match_tags = c.match_tags;
+        return t;
+      }
+
+      const Transition &step(int state, unsigned symbol) {
+        Transition &cached = transitions[std::size_t(state) * symbols + symbol];
+        if(cached.next >= 0) return cached;
+        const unsigned char byte = class_byte[symbol >> 1];
+        const bool in_code = symbol & 1;
+        Closure c;
+        c.present.assign(items.size(), false);
+        const std::vector<unsigned> threads = states[state]; // (copied: "state_id" may grow "states")
+        for(unsigned t = 0; t < threads.size() && !c.matched; ++t) {
+          const Item &item = items[threads[t]];
+          if(!item.hole) {
+            if(in_code && char(byte) == item.byte) enter(c, threads[t]+1, t, 0);
+          } else if(item.greedy ? !is_space(char(byte)) : !is_newline(char(byte))) {
+            after_hole_char(c, threads[t], t);
+          }
+        }
+        Transition built = to_transition(c);
+        packed[std::size_t(state) * symbols + symbol] = built.next << 1 | (built.match_src != npos);
+        return transitions[std::size_t(state) * symbols + symbol] = std::move(built);
+      }
+      unsigned symbol_at(std::string_view text, std::size_t p, const CodeMap *code_map) const {
+        return 2u * byte_class[static_cast<unsigned char>(text[p])] + (!code_map || code_map->is_code(p, p+1));
+      }
+
+    public:
+      // Whether this DFA was built from "prog"'s defn (so may be reused for it)
+      bool built_for(const MacroProgram &prog) const {
+        std::size_t i = 0;
+        for(auto in : prog.code) {
+          if(in.op == Op::literal) {
+            for(char ch : prog.literals[in.arg])
+              if(i == items.size() || items[i].hole || items[i++].byte != ch) return false;
+          } else if(i == items.size() || !items[i].hole || items[i].slot != in.arg || items[i++].greedy != (in.op != Op::lazy_hole)) {
+            return false;
+          }
+        }
+        return i == items.size();
+      }
+
+      // Start matching a new text: no (position, state) pair of the last 1 is dead anymore
+      void begin_text() {
+        if(++generation == 0) dead_memo.clear(); // (wrapped: entries' generations would collide)
+      }
+
+      explicit TaggedDfa(const MacroProgram &prog) {
+        for(auto in : prog.code) {
+          if(in.op == Op::literal) {
+            for(char ch : prog.literals[in.arg]) items.push_back(Item{ch, false, false, 0});
+          } else {
+            items.push_back(Item{0, true, in.op != Op::lazy_hole, in.arg});
+          }
+        }
+        // each literal byte is its own class, others only differ by space/newline
+        int kind_class[3] = {-1, -1, -1};
+        std::vector<bool> literal_byte(256, false);
+        for(auto &item : items) if(!item.hole) literal_byte[static_cast<unsigned char>(item.byte)] = true;
+        for(unsigned b = 0; b < 256; ++b) {
+          int *shared = literal_byte[b] ? nullptr : &kind_class[is_newline(char(b)) ? 2 : is_space(char(b)) ? 1 : 0];
+          if(shared && *shared >= 0) {
+            byte_class[b] = static_cast<unsigned char>(*shared);
+            continue;
+          }
+          byte_class[b] = static_cast<unsigned char>(class_byte.size());
+          if(shared) *shared = int(class_byte.size());
+          class_byte.push_back(static_cast<unsigned char>(b));
+        }
+        symbols = unsigned(class_byte.size()) * 2;
+
+        Closure c;
+        c.present.assign(items.size(), false);
+        enter(c, 0, npos, 0);
+        start = to_transition(c);
+        dead = state_id({});
+        heads.resize(items.size()), next_heads.resize(items.size()); // (a state holds each item at most once)
+      }
+
+      // Match from "s" into "m" (1 == matched, 0 == no match, -1 == too many states: backtrack instead)
+      // => most starts fail, so a 1st pass only follows states to find the match's end
+      //    (the last one found: each overrides those of lower-priority threads), &
+      //    only a match replays its transitions tracking tags
+      int match(std::string_view text, std::size_t s, const CodeMap *code_map, Match &m) {
+        if(overflowed) return -1;
+        if(dead_memo.empty()) dead_memo.resize(dead_memo_size);
+        std::size_t end = 0;
+        int state = start.next;
+        for(std::size_t p = s; p < text.size() && state != dead; ++p) {
+          auto &memo = dead_memo[p & (dead_memo_size-1)];
+          if(memo.position == p && memo.state == state && memo.generation == generation) break;
+          memo = {p, state, generation};
+          const unsigned symbol = symbol_at(text, p, code_map);
+          int next = packed[std::size_t(state) * symbols + symbol];
+          if(next < 0) {
+            if(states.size() > max_states) return overflowed = true, -1;
+            step(state, symbol);
+            next = packed[std::size_t(state) * symbols + symbol];
+          }
+          if(next & 1) end = p+1;
+          state = next >> 1;
+        }
+        if(!end) return 0;
+
+        // each thread's tags == a chain of tag events back to its start (so a step
+        // only copies 1 index per thread, logging events only where tags get set)
+        tag_log.clear();
+        auto apply = [&](const Transition &t, std::size_t p) {
+          const Thread *th_plan = plans.data() + t.first;
+          for(unsigned i = 0; i < t.count; ++i) {
+            const Thread th = th_plan[i];
+            int head = th.src == npos ? -1 : heads[th.src];
+            if(th.tags) tag_log.push_back(TagEvent{th.tags, p, head}), head = int(tag_log.size()-1);
+            next_heads[i] = head;
+          }
+          heads.swap(next_heads);
+        };
+        apply(start, s);
+        state = start.next;
+        for(std::size_t p = s; p < end; ++p) {
+          const Transition &t = transitions[std::size_t(state) * symbols + symbol_at(text, p, code_map)];
+          if(p+1 < end) {
+            apply(t, p+1);
+            state = t.next;
+            continue;
+          }
+          // the latest event setting each tag holds its position
+          const std::uint64_t all = m.captures.size() == 32 ? ~std::uint64_t(0) : (std::uint64_t(1) << (2 * m.captures.size())) - 1;
+          positions.assign(2 * m.captures.size(), 0);
+          std::uint64_t found = t.match_tags;
+          for(std::uint64_t set = found; set; set &= set-1) positions[__builtin_ctzll(set)] = end;
+          for(int e = heads[t.match_src]; e >= 0 && found != all; e = tag_log[e].parent) {
+            for(std::uint64_t set = tag_log[e].tags & ~found; set; set &= set-1) positions[__builtin_ctzll(set)] = tag_log[e].position;
+            found |= tag_log[e].tags;
+          }
+          for(std::size_t slot = 0; slot < m.captures.size(); ++slot) m.captures[slot] = {positions[2*slot], positions[2*slot+1]};
+        }
+        m.end = end;
+        return 1;
+      }
+    };
+
+
+    // What a program's scans can reuse across texts (so a warm scan stays off the
+    // heap): its built DFA & the backtracker's memo bits
+    struct MatchState {
+      std::unique_ptr<TaggedDfa> dfa;
+      std::vector<std::uint64_t> failed;
+      std::vector<std::size_t>   attempt_bits; // memo bits the current attempt set (if a step budget may cut it)
+    };
+
+    // Scans 1 text left-to-right for non-overlapping matches: each "next()"
+    // resumes at the previous match's end (like regex_search w/ match_prev_avail)
+    class Scanner {
+      const MacroProgram             &prog;
+      std::string_view                text;
+      std::size_t                     pos = 0;
+      Match                          *out = nullptr;
+      const std::vector<std::size_t> *candidates = nullptr; // sorted positions of "prog.anchor()"
+      const CodeMap                  *code_map = nullptr;   // literals may only match code
+      std::size_t                     next_candidate = 0;
+      std::size_t                     tried_upto = 0; // starts < this were already tried
+      std::size_t                     run_checked = 0, run_begin = 0; // text[run_begin,run_checked) has no spaces
+      std::uint64_t                   step_budget = 0, steps = 0; // backtracking steps per attempt (0 == no cap), this attempt's
+      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+      std::uint64_t                   ticks = 0;      // steps since the scan began (the clock's read every 1024)
+      bool                            limited = false, cut_short = false, timed_out = false;
+      std::size_t                     budget_hits = 0, cut_at = 0; // attempts cut short, & the 1st's (or the timed out 1's) start
+      std::size_t                     attempts = 0;   // starts tried (for profiling)
+      MatchState                      own_state;
+      MatchState                     *shared_state = nullptr; // (reused across texts, if given)
+      bool                            memo_ready = false, dfa_ready = false;
+
+      MatchState &state() {return shared_state ? *shared_state : own_state;}
+
+      bool memo_failed(unsigned row, std::size_t p) {
+        std::vector<std::uint64_t> &failed = state().failed;
+        if(!memo_ready) failed.assign((prog.memo_rows * (text.size()+1) + 63) / 64, 0), memo_ready = true;
+        const std::size_t bit = row * (text.size()+1) + p;
+        if(failed[bit/64] & (std::uint64_t(1) << (bit%64))) return true;
+        failed[bit/64] |= std::uint64_t(1) << (bit%64);
+        if(step_budget) state().attempt_bits.push_back(bit); // (<= 1 per step: bounded by the budget)
+        return false;
+      }
+
+      // 1st char of the literal following instruction "pc" (if any) to skip dead ends
+      const char *next_literal_char(std::size_t pc) const {
+        if(pc+1 == prog.code.size() || prog.code[pc+1].op != Op::literal) return nullptr;
+        return prog.literals[prog.code[pc+1].arg].data();
+      }
+
+      // Count 1 step: true once this attempt's over its step budget, or the scan's past its deadline
+      bool out_of_steps() {
+        if(!limited || cut_short) return cut_short;
+        if(step_budget && ++steps > step_budget) return cut_short = true;
+        if(deadline != std::chrono::steady_clock::time_point::max() && !(++ticks & 1023) && std::chrono::steady_clock::now() >= deadline)
+          return cut_short = timed_out = true;
+        return false;
+      }
+
+      // Match instructions "pc" onward at "p": recursion only at holes, so depth <= # of $vars
+      bool run(std::size_t pc, std::size_t p) {
+        const std::size_t n = text.size();
+        if(out_of_steps()) return false;
+        for(; pc < prog.code.size(); ++pc) {
+          const Instr in = prog.code[pc];
+          switch(in.op) {
+            case Op::literal: {
+              const std::string &lit = prog.literals[in.arg];
+              if(text.compare(p, lit.size(), lit) != 0) return false;
+              if(code_map && !code_map->is_code(p, p + lit.size())) return false;
+              p += lit.size();
+              break;
+            }
+            case Op::backref: {
+              const auto cap = out->captures[in.arg];
+              const std::size_t len = cap.second - cap.first;
+              if(text.compare(p, len, text.substr(cap.first, len)) != 0) return false;
+              p += len;
+              break;
+            }
+            case Op::trail_hole: {
+              std::size_t e = p;
+              while(e < n && !is_space(text[e])) ++e;
+              if(e == p) return false;
+              out->captures[in.arg] = {p, e};
+              p = e;
+              break;
+            }
+            case Op::lead_hole: {
+              std::size_t e = p;
+              while(e < n && !is_space(text[e])) ++e;
+              const char *need = next_literal_char(pc);
+              for(; e > p; --e) { // greedy: longest capture 1st
+                if(out_of_steps()) return false;
+                if(need && (e == n || text[e] != *need)) continue;
+                out->captures[in.arg] = {p, e};
+                if(run(pc+1, e)) return true;
+              }
+              return false;
+            }
+            case Op::lazy_hole: {
+              if(p == n || is_newline(text[p])) return false;
+              const char *need = next_literal_char(pc);
+              for(std::size_t e = p+1;; ++e) { // lazy: shortest capture 1st
+                if(out_of_steps()) return false;
+                if(!prog.backrefs && memo_failed(in.memo, e)) return false;
+                if(!need || (e < n && text[e] == *need)) {
+                  out->captures[in.arg] = {p, e};
+                  if(run(pc+1, e)) return true;
+                }
+                if(e == n || is_newline(text[e])) return false;
+              }
+            }
+          }
+        }
+        out->end = p;
+        return true;
+      }
+
+      // Match from "s" via the DFA if the program has 1 (& it hasn't outgrown its state cap)
+      // => an attempt over its step budget fails, clearing the memo bits it set (their
+      //    positions weren't fully explored), & once past the deadline every attempt does
+      bool attempt(std::size_t s) {
+        ++attempts;
+        steps = 0;
+        if(step_budget) state().attempt_bits.clear();
+        if(out_of_steps()) return cut_at = s, false;
+        if(prog.uses_dfa()) {
+          std::unique_ptr<TaggedDfa> &dfa = state().dfa;
+          if(!dfa_ready) {
+            if(!dfa || !dfa->built_for(prog)) dfa = std::make_unique<TaggedDfa>(prog);
+            dfa->begin_text(), dfa_ready = true;
+          }
+          const int matched = dfa->match(text, s, code_map, *out);
+          if(matched >= 0) return matched;
+        }
+        const bool matched = run(0, s);
+        if(!cut_short) return matched;
+        if(timed_out) return cut_at = s, false;
+        if(!budget_hits++) cut_at = s;
+        std::vector<std::uint64_t> &failed = state().failed;
+        for(auto bit : state().attempt_bits) failed[bit/64] &= ~(std::uint64_t(1) << (bit%64));
+        cut_short = false;
+        return false;
+      }
+
+      // Start (from "pos" on) of the non-space run ending at anchor occurrence "q":
+      // walks back only to the last occurrence's, reusing its run's start, so a
+      // scan walks each byte at most once however many anchors share a run
+      std::size_t lead_run_start(std::size_t q) {
+        std::size_t s = q;
+        while(s > std::max(pos, run_checked) && !is_space(text[s-1])) --s;
+        if(s == run_checked) s = std::max(run_begin, pos);
+        run_checked = q, run_begin = s;
+        return s;
+      }
+
+      // Only try the starts implied by the anchor's occurrences: the occurrence
+      // itself, or the non-space run ending right before it for a leading $var
+      bool next_from_candidates(Match &m) {
+        const bool lead = prog.code.front().op == Op::lead_hole;
+        for(; next_candidate < candidates->size(); ++next_candidate) {
+          const std::size_t q = (*candidates)[next_candidate];
+          if(q < pos) continue;
+          std::size_t s = q;
+          if(lead) {
+            s = lead_run_start(q);
+            if(s == q) continue;
+            // w/o backreferences a failed run start rules out its whole run (see "next")
+            if(!prog.backrefs && s < tried_upto) continue;
+          }
+          s = std::max(s, tried_upto);
+          // w/ backreferences every start in the leading run is distinct
+          const std::size_t last_start = (lead && prog.backrefs) ? q-1 : s;
+          for(; s <= last_start && !timed_out; ++s) {
+            tried_upto = s+1;
+            if(attempt(s)) {
+              m.begin = s;
+              pos = tried_upto = m.end;
+              return true;
+            }
+          }
+          if(timed_out) break;
+        }
+        pos = text.size();
+        return false;
+      }
+
+    public:
+      Scanner(const MacroProgram &program, std::string_view buffer) : prog(program), text(buffer) {}
+      // Restrict the scan to the starts implied by "anchor_positions" (all occurrences of "program.anchor()")
+      Scanner(const MacroProgram &program, std::string_view buffer, const std::vector<std::size_t> &anchor_positions)
+        : prog(program), text(buffer), candidates(&anchor_positions) {}
+
+      // Keep the DFA & memo in "reused" (ie 1 per alias, across the texts it scans)
+      void reuse_state(MatchState &reused) {shared_state = &reused;}
+
+      std::size_t position()      const {return pos;}
+      std::size_t attempt_count() const {return attempts;}
+
+      // Cap each attempt at "steps_per_attempt" backtracking steps (0 == no cap), & give
+      // up the scan at "scan_deadline": see "budget_hit_count()" & "ran_out_of_time()"
+      void limit(std::uint64_t steps_per_attempt, std::chrono::steady_clock::time_point scan_deadline) {
+        step_budget = steps_per_attempt, deadline = scan_deadline;
+        limited = step_budget || deadline != std::chrono::steady_clock::time_point::max();
+      }
+      std::size_t budget_hit_count() const {return budget_hits;} // attempts cut short (so skipped)
+      bool        ran_out_of_time()  const {return timed_out;}
+      std::size_t cut_short_at()     const {return cut_at;}      // the 1st cut attempt's start (or the timed out 1's)
+
+      // Only match the defn's literals w/in "map"'s code ($vars may still span 
+      // comments & literals, ie a string argument)
+      void only_in_code(const CodeMap *map) {code_map = map;}
+
+      bool next(Match &m) {
+        const std::size_t n = text.size();
+        if(prog.empty()) return false;
+        out = &m;
+        m.captures.assign(prog.capture_count(), {0, 0});
+        if(candidates) return next_from_candidates(m);
+        const Instr first = prog.code.front();
+
+        for(std::size_t s = pos; s < n;) {
+          if(first.op == Op::literal) {                     // jump straight to the leading literal
+            s = find_literal(text, prog.literals[first.arg], s);
+            if(s == std::string_view::npos) break;
+          } else if(first.op == Op::lead_hole) {
+            while(s < n && is_space(text[s])) ++s;
+            if(s == n) break;
+          }
+          if(attempt(s)) {
+            m.begin = s;
+            pos = m.end;
+            return true;
+          }
+          if(timed_out) break;
+          // w/o backreferences only the start of a non-space run can match a leading
+          // $var: any later start in the run has a subset of the run start's options
+          if(first.op == Op::lead_hole && !prog.backrefs)
+            while(s < n && !is_space(text[s])) ++s;
+          else
+            ++s;
+        }
+        pos = n;
+        return false;
+      }
+    };
+  };
+
+
+  // Aho-Corasick automaton over many anchor literals: finds every occurrence of
+  // every anchor in 1 pass (bytes mapped to classes to keep the table compact)
+  class AnchorSet {
+    std::vector<std::string>            anchors;
+    std::unordered_map<std::string,unsigned> anchor_ids;
+    std::vector<unsigned char>          byte_class = std::vector<unsigned char>(256, 0);
+    unsigned                            classes = 1; // class 0 == bytes in no anchor
+    std::vector<unsigned>               delta;       // states x classes
+    std::vector<std::vector<unsigned>>  outputs;     // anchor ids ending at each state
+    ByteSet                             first_bytes; // bytes leaving the root state (if all rare, "scan" skips to them)
+    bool                                skip_to_first_bytes = false;
+    std::size_t                         longest = 0;
+    bool                                built = false;
+
+  public:
+    // Register "anchor" (returns its id, shared by identical anchors)
+    unsigned add(const std::string &anchor) {
+      auto found = anchor_ids.find(anchor);
+      if(found != anchor_ids.end()) return found->second;
+      built = false;
+      anchor_ids.emplace(anchor, unsigned(anchors.size()));
+      anchors.push_back(anchor);
+      longest = std::max(longest, anchor.size());
+      return unsigned(anchors.size()-1);
+    }
+
+    std::size_t size()          const {return anchors.size();}
+    std::size_t longest_anchor() const {return longest;}
+    const std::string &anchor(unsigned id) const {return anchors[id];}
+
+    void build() {
+      if(built) return;
+      built = true;
+      std::fill(byte_class.begin(), byte_class.end(), 0);
+      classes = 1;
+      std::string firsts;
+      for(auto &a : anchors) firsts += a.front();
+      first_bytes = ByteSet(firsts);
+      skip_to_first_bytes = std::all_of(firsts.begin(), firsts.end(), [](char c) {return source_byte_rank(c) < 2;});
+      for(auto &a : anchors)
+        for(unsigned char c : a)
+          if(!byte_class[c]) byte_class[c] = classes++;
+
+      // trie
+      std::vector<std::vector<unsigned>> trie(1, std::vector<unsigned>(classes, 0));
+      outputs.assign(1, {});
+      for(unsigned id = 0; id < anchors.size(); ++id) {
+        unsigned state = 0;
+        for(unsigned char c : anchors[id]) {
+          if(!trie[state][byte_class[c]]) {
+            trie[state][byte_class[c]] = unsigned(trie.size());
+            trie.emplace_back(classes, 0);
+            outputs.emplace_back();
+          }
+          state = trie[state][byte_class[c]];
+        }
+        outputs[state].push_back(id);
+      }
+
+      // BFS failure links, folded straight into a dense transition table
+      std::vector<unsigned> fail(trie.size(), 0), queue;
+      delta.assign(trie.size() * classes, 0);
+      for(unsigned c = 1; c < classes; ++c)
+        if(trie[0][c]) {
+          delta[c] = trie[0][c];
+          queue.push_back(trie[0][c]);
+        }
+      for(std::size_t head = 0; head < queue.size(); ++head) {
+        const unsigned state = queue[head];
+        auto &inherited = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+        for(unsigned c = 0; c < classes; ++c) {
+          const unsigned child = c ? trie[state][c] : 0;
+          if(child) {
+            fail[child] = delta[fail[state]*classes + c];
+            delta[state*classes + c] = child;
+            queue.push_back(child);
+          } else {
+            delta[state*classes + c] = delta[fail[state]*classes + c];
+          }
+        }
+      }
+    }
+
+    // Calls "hit(anchor id, start position)" for each occurrence starting w/in
+    // [begin,end) of "text" (occurrences may run past "end", up to text's end)
+    template <typename HitFn>
+    void scan(std::string_view text, std::size_t begin, std::size_t end, HitFn hit) const {
+      if(anchors.empty()) return;
+      unsigned state = 0;
+      const std::size_t stop = std::min(text.size(), end + longest - 1);
+      for(std::size_t i = begin; i < stop; ++i) {
+        if(!state && skip_to_first_bytes && (i = first_bytes.find(text.substr(0, stop), i)) == std::string_view::npos) break;
+        state = delta[state*classes + byte_class[static_cast<unsigned char>(text[i])]];
+        for(unsigned id : outputs[state]) {
+          const std::size_t start = i+1 - anchors[id].size();
+          if(start >= begin && start < end) hit(id, start);
+        }
+      }
+    }
+  };
+
+
+  // Per-alias mapping costs, shared by every copy of the Script profiled (ie
+  // batch workers): finds the aliases slowing a build down (to reorder/rewrite)
+  class MacroProfile {
+  public:
+    using Clock = std::chrono::steady_clock;
+    static double seconds_since(Clock::time_point start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    struct Stats {
+      std::string   alias, cpp_key; // #defmac syntax (or "(regex)") & its C++ key
+      double        compile_seconds = 0;
+      double        search_seconds = 0, expand_seconds = 0;
+      double        distribute_seconds = 0; // type distribution (part of expanding)
+      std::uint64_t attempts = 0;      // match starts tried (regex aliases: searches)
+      std::uint64_t matches = 0;
+      std::uint64_t bytes_scanned = 0; // buffer bytes searched
+      std::uint64_t allocations = 0;   // heap allocations while searching & expanding
+      double total_seconds() const {return compile_seconds + search_seconds + expand_seconds;}
+    };
+
+  private:
+    std::mutex lock;
+    std::vector<Stats> stats;
+    std::unordered_map<std::string,std::size_t> slots; // "alias\0cpp_key" -> stats idx
+
+    static std::string json_string(const std::string &str) {
+      std::string out("\"");
+      for(unsigned char c : str) {
+        if(c == '"' || c == '\\') out += '\\', out += char(c);
+        else if(c == '\n') out += "\\n";
+        else if(c < 0x20) {
+          static const char hex[] = "0123456789abcdef";
+          out += "\\u00", out += hex[c >> 4], out += hex[c & 0xf];
+        } else out += char(c);
+      }
+      return out + '"';
+    }
+
+  public:
+    // The slot of "alias" w/ C++ key "cpp_key" (1 slot per pair, across files)
+    std::size_t slot(const std::string &alias, const std::string &cpp_key) {
+      std::lock_guard<std::mutex> guard(lock);
+      auto found = slots.emplace(alias + '\0' + cpp_key, stats.size());
+      if(found.second) {
+        stats.emplace_back();
+        stats.back().alias = alias, stats.back().cpp_key = cpp_key;
+      }
+      return found.first->second;
+    }
+
+    void add(std::size_t slot, const Stats &delta) {
+      std::lock_guard<std::mutex> guard(lock);
+      Stats &total = stats[slot];
+      total.compile_seconds    += delta.compile_seconds;
+      total.search_seconds     += delta.search_seconds;
+      total.expand_seconds     += delta.expand_seconds;
+      total.distribute_seconds += delta.distribute_seconds;
+      total.attempts           += delta.attempts;
+      total.matches            += delta.matches;
+      total.bytes_scanned      += delta.bytes_scanned;
+      total.allocations        += delta.allocations;
+    }
+
+    // Every alias's stats, costliest 1st
+    std::vector<Stats> sorted() {
+      std::lock_guard<std::mutex> guard(lock);
+      std::vector<Stats> by_cost(stats);
+      std::stable_sort(by_cost.begin(), by_cost.end(), [](const Stats &a, const Stats &b) {return a.total_seconds() > b.total_seconds();});
+      return by_cost;
+    }
+
+    // Table of times (ms) & counts, costliest alias 1st
+    void report(std::ostream &out) {
+      const auto by_cost = sorted();
+      out << "\033[1m-:- Macro Profile (" << by_cost.size() << " aliases, costliest 1st) -:-\033[0m\n"
+          << "  total ms  search ms  expand ms  (types)  compile ms    attempts     matches  scanned MB   allocs  alias\n";
+      const auto flags = out.flags();
+      out << std::fixed;
+      for(auto &s : by_cost)
+        out << std::setprecision(2) << std::setw(10) << s.total_seconds()*1e3 << std::setw(11) << s.search_seconds*1e3
+            << std::setw(11) << s.expand_seconds*1e3 << std::setw(9) << s.distribute_seconds*1e3 
+            << std::setw(12) << s.compile_seconds*1e3 << std::setw(12) << s.attempts << std::setw(12) << s.matches 
+            << std::setw(12) << s.bytes_scanned / (1024.0*1024.0) << std::setw(9) 
+            << (counts_allocations ? std::to_string(s.allocations) : "n/a") << "  " << s.alias << '\n';
+      out.flags(flags);
+    }
+
+    // The same as 1 JSON object: {"aliases":[{...}, ...]}
+    void report_json(std::ostream &out) {
+      const auto by_cost = sorted();
+      out << "{\"aliases\":[";
+      for(std::size_t i = 0; i < by_cost.size(); ++i) {
+        const Stats &s = by_cost[i];
+        out << (i ? ",\n" : "\n") << "{\"alias\":" << json_string(s.alias) << ",\"cpp\":" << json_string(s.cpp_key)
+            << ",\"total_ms\":" << s.total_seconds()*1e3 << ",\"search_ms\":" << s.search_seconds*1e3 
+            << ",\"expand_ms\":" << s.expand_seconds*1e3 << ",\"distribute_ms\":" << s.distribute_seconds*1e3 
+            << ",\"compile_ms\":" << s.compile_seconds*1e3 << ",\"attempts\":" << s.attempts 
+            << ",\"matches\":" << s.matches << ",\"bytes_scanned\":" << s.bytes_scanned 
+            << ",\"allocations\":" << (counts_allocations ? std::to_string(s.allocations) : "null") << "}";
+      }
+      out << "\n]}\n";
+    }
+  };
+};  // end of namespace DEF_MAC
+
+/******************************************************************************
+* WORK-STEALING THREAD POOL: BATCHES OF FILES & CHUNKS OF 1 FILE
+******************************************************************************/
+
+namespace DEF_MAC {
+  // Runs task(0) ... task(task_count-1) across "worker_count" threads (0 == all 
+  // cores): each worker drains its own deque from the back, then steals from the 
+  // front of the others' (so uneven file/chunk sizes still keep every core busy)
+  class WorkStealingPool {
+    struct TaskQueue {
+      std::mutex              lock;
+      std::deque<std::size_t> tasks;
+    };
+
+  public:
+    static void run(std::size_t task_count, unsigned worker_count, const std::function<void(std::size_t)> &task) {
+      if(!worker_count) worker_count = std::max(1u, std::thread::hardware_concurrency());
+      worker_count = unsigned(std::min<std::size_t>(worker_count, task_count));
+      if(worker_count <= 1) {
+        for(std::size_t i = 0; i < task_count; ++i) task(i);
+        return;
+      }
+
+      std::vector<TaskQueue> queues(worker_count);
+      for(std::size_t i = 0; i < task_count; ++i) // contiguous blocks per worker
+        queues[i * worker_count / task_count].tasks.push_back(i);
+
+      std::mutex         failure_lock;
+      std::exception_ptr failure;
+      auto work = [&](unsigned self) {
+        for(;;) {
+          std::size_t next = 0;
+          bool found = false;
+          for(unsigned k = 0; !found && k < worker_count; ++k) {
+            TaskQueue &queue = queues[(self + k) % worker_count];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if(queue.tasks.empty()) continue;
+            if(!k) next = queue.tasks.back(),  queue.tasks.pop_back();  // own work: LIFO
+            else   next = queue.tasks.front(), queue.tasks.pop_front(); // stolen work: FIFO
+            found = true;
+          }
+          if(!found) return; // tasks never get added, so all queues are drained
+          try {
+            task(next);
+          } catch(...) {
+            std::lock_guard<std::mutex> guard(failure_lock);
+            if(!failure) failure = std::current_exception();
+          }
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for(unsigned w = 1; w < worker_count; ++w) workers.emplace_back(work, w);
+      work(0);
+      for(auto &worker : workers) worker.join();
+      if(failure) std::rethrow_exception(failure);
+    }
+  };
+};   // end of namespace DEF_MAC
+
 /******************************************************************************
 * CUSTOM SCRIPT SYNTAX MAP: USES VECTOR OF PAIRS W/ C++ KEYS & SCRIPT VALS
 ******************************************************************************/
@@ -100,6 +1599,30 @@ namespace DEF_MAC {
     using SyntaxIterator = std::vector<std::pair<string,regex>>::iterator;
     using PrefixIterator = std::vector<string>::iterator;
 
+    // Incremental re-mapping ("remap_file"): the last mapping's directive-free
+    // input "body", its mapped "output" (untrimmed, w/o "header"), & the span
+    // index of which line-aligned input span became which output span
+    struct MappedSpan {
+      std::size_t in_begin, in_end, out_begin, out_end;
+    };
+    struct IncrementalState {
+      bool                    valid = false;
+      string                  signature, header, body, output;
+      std::vector<MappedSpan> spans;
+      std::vector<string>     sources; // the input & the "#defmac_include"s it names
+    };
+
+    // 1 #defmac compiled ahead of time: a "defmac --emit-matcher" header's "macros"
+    struct StaticDefmac {
+      struct Prefix {
+        std::string_view type, token;
+      };
+      std::string_view     cpp_key;
+      MacroProgram::Static program;
+      const Prefix        *prefixes;
+      std::size_t          prefix_count;
+    };
+
 
 
   private:
@@ -107,29 +1630,694 @@ namespace DEF_MAC {
     SyntaxMap    script_syntax; // a "syntax map" of "C++ to Script" aliases
     PrefixVector file_prefixes;
 
+    // Parallel to "script_syntax": #defmac aliases hold their compiled matcher
+    // (& an unused empty regex), hand-written regex aliases hold an empty program
+    std::vector<MacroProgram> script_programs;
+
+    // Multi-alias literal prefilter: 1 automaton over every compiled alias's anchor,
+    // rebuilt lazily once the alias set changes
+    AnchorSet        script_anchors;
+    std::vector<int> script_anchor_ids; // parallel to "script_syntax": anchor id OR -1 (always scan)
+    bool             anchors_stale = true;
+
+    using AnchorHits = std::vector<std::vector<std::size_t>>; // sorted positions, by anchor id
+
+    // Parallel to "script_syntax": each alias's C++ key compiled for expansion
+    struct ReplacementTemplate;
+    std::vector<ReplacementTemplate> script_templates;
+
+    // Parallel to "script_syntax" once profiling: each alias's "profile" slot
+    std::vector<std::size_t> script_profile_slots;
+
+    // 1 replaced match: [old_begin,old_end) of the old buffer became
+    // [new_begin,new_begin+new_size) of the new buffer
+    struct Edit {
+      std::size_t old_begin, old_end, new_begin, new_size;
+    };
+
+    // 1 mapping's working memory, kept between runs: once warm, a run's matches,
+    // expansions (appended to "mapped_buffer", captures being views into the
+    // input), & anchor updates reuse these buffers rather than the heap
+    struct MappingScratch {
+      string                                 mapped_buffer;
+      std::vector<Edit>                      edits;
+      AnchorHits                             anchor_hits, added_hits;
+      std::vector<std::size_t>               merged_hits;
+      MacroProgram::Match                    program_match;
+      std::smatch                            matches;
+      std::vector<MacroProgram::MatchState>  match_states; // parallel to "script_programs"
+    };
+
+    // Spare "MappingScratch"es, 1 per concurrent mapping (ie chunk workers): a
+    // copied Script (ie a batch worker's) starts w/ none of its own
+    class ScratchPool {
+      std::mutex                                   lock;
+      std::vector<std::unique_ptr<MappingScratch>> spare;
+    public:
+      ScratchPool() = default;
+      ScratchPool(const ScratchPool &) {}
+      ScratchPool &operator=(const ScratchPool &) {return *this;}
+      std::unique_ptr<MappingScratch> acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if(spare.empty()) return std::make_unique<MappingScratch>();
+        auto scratch = std::move(spare.back());
+        spare.pop_back();
+        return scratch;
+      }
+      void release(std::unique_ptr<MappingScratch> scratch) {
+        std::lock_guard<std::mutex> guard(lock);
+        spare.push_back(std::move(scratch));
+      }
+    };
+    ScratchPool scratch_pool;
+
 
     // Struct For Type-Prefixed #defmac Variables
     struct type_prefix_data {
       string type, token;
       type_prefix_data(string ty, string to) : type(ty), token(to) {}
     };
-    std::unordered_multimap<std::string,type_prefix_data> 
-    formatted_prefixed_token_data; // Filled with instances of prefixed data as \v{n}
+
+
+    // 1 compiled #defmac: C++ key (w/ \v{n} placeholders), matcher, & type-distribution data
+    struct DefmacAlias {
+      string                        cpp_key;
+      MacroProgram                  program;
+      std::vector<type_prefix_data> prefixes;
+    };
+
+    // All a ".dmac" file registers (incl. via nested #defmac_include's), & the
+    // sources (w/ content hashes) it was compiled from: cached as 1 unit
+    struct MacroSet {
+      std::vector<std::pair<string,std::uint64_t>> sources;
+      std::vector<DefmacAlias>                     aliases;
+      std::vector<double>                          compile_seconds; // per alias, if compiled this run (not cached)
+    };
+    MacroSet *macro_set_recorder = nullptr; // ".dmac" file currently being compiled
+
+    // ".dmac" files compiled once & shared read-only by every copy of a Script
+    // (ie batch workers), keyed by their absolute "#defmac_include" path
+    // => "revalidate" stores (ie a server's) also key sets by their file's mtime
+    //    & size, recompiling them once edited
+    using SharedMacroSet = std::shared_ptr<const MacroSet>;
+    class MacroSetStore {
+      using Stamp = std::pair<std::filesystem::file_time_type,std::uintmax_t>;
+      struct Entry {
+        std::shared_future<SharedMacroSet> set;
+        Stamp                              stamp;
+      };
+      std::mutex lock;
+      std::unordered_map<string,Entry> sets;
+      static Stamp stamp_of(const string &path) {
+        std::error_code ec;
+        return Stamp(std::filesystem::last_write_time(path, ec), std::filesystem::file_size(path, ec));
+      }
+    public:
+      // "path" canonicalized (absolute & normalized), as sets are keyed
+      static string key_of(const string &path) {
+        std::error_code ec;
+        const auto absolute = std::filesystem::absolute(path, ec);
+        return ec ? path : absolute.lexically_normal().string();
+      }
+      const bool revalidate;
+      explicit MacroSetStore(bool revalidate_sets = false) : revalidate(revalidate_sets) {}
+      // true if the caller must compile "path" & fulfil "compiled", else "set" 
+      // yields the set once the Script compiling it finishes
+      bool claim(const string &path, std::shared_future<SharedMacroSet> &set, std::promise<SharedMacroSet> &compiled) {
+        const string key = key_of(path);
+        const Stamp stamp = revalidate ? stamp_of(path) : Stamp(); // taken before the claimer reads "path"
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = sets.find(key);
+        if(found != sets.end() && found->second.stamp == stamp) return set = found->second.set, false;
+        sets[key] = Entry{compiled.get_future().share(), stamp};
+        return true;
+      }
+      // drop "path"'s set if it's still "stale" (or failed to compile), so the next claim recompiles it
+      void evict(const string &path, const SharedMacroSet &stale) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = sets.find(key_of(path));
+        if(found == sets.end() || found->second.set.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        try {
+          if(found->second.set.get() != stale) return;
+        } catch(...) {} // failed sets always go
+        sets.erase(found);
+      }
+    };
+    std::shared_ptr<MacroSetStore> shared_macro_sets;
 
 
     // Private Methods
     // Merges all strings in container "string_container" and return their accumulation
     template <typename T>
-    string merge_container_strings(const T string_container) {
+    string merge_container_strings(const T &string_container) {
+      std::size_t size = 0;
+      for(auto &str : string_container) size += str.size();
       string accumulated_string;
-      for(string str : string_container)
+      accumulated_string.reserve(size);
+      for(auto &str : string_container)
         accumulated_string += str;
       return accumulated_string;
     }
 
+    // A C++ key compiled once for expansion: the literal text before each of its
+    // \v{n} placeholders (& after the last), & each placeholder's capture # & the
+    // "type " to distribute over it (prefixing each identifier of the capture)
+    // => type-prefix data is resolved here, from the alias's own "prefixes"
+    struct ReplacementTemplate {
+      struct Segment {
+        string literal;
+        int    capture = -1; // -1 == the trailing literal
+        string type_prefix;  // "" == no type distribution
+      };
+      string                        cpp_key; // compiled from (recompiled if edited via "alias_begin()")
+      std::vector<type_prefix_data> prefixes;
+      std::vector<Segment>          segments;
+      std::size_t                   literal_size = 0;
+    };
+
+    static ReplacementTemplate compile_replacement(const string &cpp_key, const std::vector<type_prefix_data> &prefixes = {}) {
+      ReplacementTemplate compiled;
+      compiled.cpp_key = cpp_key, compiled.prefixes = prefixes;
+      ReplacementTemplate::Segment segment;
+      for(std::size_t i = 0; i < cpp_key.size();) {
+        if(cpp_key[i] != '\\' || i+2 >= cpp_key.size() || cpp_key[i+1] != 'v' || !std::isdigit(static_cast<unsigned char>(cpp_key[i+2]))) {
+          segment.literal += cpp_key[i++];
+          continue;
+        }
+        std::size_t digits_end = i+2;
+        long long idx = 0;
+        for(; digits_end < cpp_key.size() && std::isdigit(static_cast<unsigned char>(cpp_key[digits_end])); ++digits_end)
+          idx = std::min(idx * 10 + (cpp_key[digits_end] - '0'), 1LL << 30);
+        segment.capture = int(idx);
+        const string token = cpp_key.substr(i, digits_end-i);
+        for(auto &prefix : prefixes)
+          if(prefix.token == token) {
+            segment.type_prefix = prefix.type + ' ';
+            break;
+          }
+        compiled.literal_size += segment.literal.size();
+        compiled.segments.push_back(std::move(segment));
+        segment = ReplacementTemplate::Segment();
+        i = digits_end;
+      }
+      compiled.literal_size += segment.literal.size();
+      compiled.segments.push_back(std::move(segment));
+      return compiled;
+    }
+
+    // Append "capture" to "out", prefixing each identifier in it w/ "type_prefix"
+    // (1 pass: identifiers == [_[:alpha:]]\w* in the "C" locale)
+    static void distribute_type(string &out, std::string_view capture, const string &type_prefix) {
+      auto is_alpha = [](char c) {return unsigned((c | 0x20) - 'a') < 26u || c == '_';};
+      auto is_word  = [&](char c) {return is_alpha(c) || unsigned(c - '0') < 10u;};
+      std::size_t copied = 0;
+      for(std::size_t i = 0; i < capture.size();) {
+        if(!is_alpha(capture[i])) {
+          ++i;
+          continue;
+        }
+        std::size_t end = i+1;
+        while(end < capture.size() && is_word(capture[end])) ++end;
+        out.append(capture.data() + copied, i-copied).append(type_prefix).append(capture.data() + i, end-i);
+        copied = i = end;
+      }
+      out.append(capture.data() + copied, capture.size()-copied);
+    }
+
+    // Append 1 match's expansion to "out" ("capture(n)" == its \v{n} value)
+    // => "distribute_seconds" (if given) accrues the time spent distributing types
+    template <typename CaptureFn>
+    static void expand_replacement(string &out, const ReplacementTemplate &compiled, CaptureFn capture,
+                                   double *distribute_seconds = nullptr) {
+      for(auto &segment : compiled.segments) {
+        out += segment.literal;
+        if(segment.capture < 0) break;
+        const std::string_view value = capture(segment.capture);
+        if(segment.type_prefix.empty()) {
+          out += value;
+        } else if(distribute_seconds) {
+          const auto distribute_start = MacroProfile::Clock::now();
+          distribute_type(out, value, segment.type_prefix);
+          *distribute_seconds += MacroProfile::seconds_since(distribute_start);
+        } else {
+          distribute_type(out, value, segment.type_prefix);
+        }
+      }
+    }
+
+    // Register 1 compiled #defmac (recording it if compiling a cacheable ".dmac" file)
+    void register_defmac(const DefmacAlias &alias, double compile_seconds = 0) {
+      if(profile) {
+        MacroProfile::Stats compiled;
+        compiled.compile_seconds = compile_seconds;
+        profile->add(profile->slot(alias.program.syntax_source(), alias.cpp_key), compiled);
+      }
+      if(show_info)
+        std::cout << std::endl << alias.program.regex_source() << "  (" << alias.program.engine_name() << ')'
+                  << std::endl << alias.cpp_key << std::endl;
+      push_defmac_alias(alias.cpp_key, alias.program, alias.prefixes);
+      if(macro_set_recorder) macro_set_recorder->aliases.push_back(alias);
+    }
+
+
+    // Register a whole compiled ".dmac" set (recording it into any enclosing set),
+    // profiling its compile times if "fresh" (ie not already registered once)
+    void register_macro_set(const MacroSet &macro_set, bool fresh = false) {
+      for(std::size_t i = 0; i < macro_set.aliases.size(); ++i)
+        register_defmac(macro_set.aliases[i], fresh && i < macro_set.compile_seconds.size() ? macro_set.compile_seconds[i] : 0);
+      if(macro_set_recorder)
+        macro_set_recorder->sources.insert(macro_set_recorder->sources.end(), macro_set.sources.begin(), macro_set.sources.end());
+    }
+
+
+    // Cached macro sets: "<macro_cache_dir>/<content hash>.dmacc", holding a
+    // header (format, tool version & build, source size & hash), the sources
+    // to revalidate, & each alias's C++ key, program, & type-prefix data
+    string macro_cache_file(std::uint64_t hash) const {
+      static const char hex[] = "0123456789abcdef";
+      string name(16, '0');
+      for(int i = 15; i >= 0; --i, hash >>= 4) name[i] = hex[hash & 0xf];
+      return macro_cache_dir + "/" + name + ".dmacc";
+    }
+
+    static string macro_cache_header() {
+      return string("DMACC\x01") + VERSION + " " + __DATE__ + " " + __TIME__;
+    }
+
+    // Load the macro set cached for a ".dmac" w/ content "hash" & size "size"
+    // (false if missing, stale, or corrupt: it's then recompiled & rewritten)
+    bool load_macro_cache(std::uint64_t hash, std::size_t size, MacroSet &macro_set) const {
+      using namespace std;
+      ifstream cache_file(macro_cache_file(hash), ios::binary);
+      if(!cache_file.is_open()) return false;
+      string bytes;
+      cache_file.seekg(0, ios::end);
+      bytes.resize(size_t(cache_file.tellg()));
+      cache_file.seekg(0, ios::beg);
+      if(!cache_file.read(&bytes[0], bytes.size())) return false; // single read of the whole set
+
+      ByteReader in{bytes};
+      if(in.get_str() != macro_cache_header() || in.get<uint64_t>() != hash || in.get<uint64_t>() != size) return false;
+      macro_set.sources.resize(in.get_count());
+      for(auto &source : macro_set.sources) source.first = in.get_str(), source.second = in.get<uint64_t>();
+      macro_set.aliases.resize(in.get_count());
+      for(auto &alias : macro_set.aliases) {
+        alias.cpp_key = in.get_str();
+        if(!in.ok || !MacroProgram::deserialize(in, alias.program)) return false;
+        const auto prefix_count = in.get_count();
+        for(uint32_t i = 0; i < prefix_count && in.ok; ++i) {
+          string type = in.get_str();
+          alias.prefixes.emplace_back(type, in.get_str());
+        }
+      }
+      return in.ok && in.bytes.empty() && nested_sources_unchanged(macro_set);
+    }
+
+    // nested #defmac_include's must still hold the content the set was built from
+    static bool nested_sources_unchanged(const MacroSet &macro_set) {
+      using namespace std;
+      for(size_t i = 1; i < macro_set.sources.size(); ++i) {
+        ifstream source(macro_set.sources[i].first.c_str(), ios::binary);
+        if(!source.is_open()) return false;
+        string content = {istreambuf_iterator<char>(source), istreambuf_iterator<char>{}};
+        if(content_hash(content) != macro_set.sources[i].second) return false;
+      }
+      return true;
+    }
+
+    // Best-effort: write to a temp file & rename it into place, so concurrent
+    // builds never read a partial set
+    void save_macro_cache(std::uint64_t hash, std::size_t size, const MacroSet &macro_set) {
+      using namespace std;
+      ByteWriter out;
+      out.put_str(macro_cache_header());
+      out.put(uint64_t(hash)), out.put(uint64_t(size));
+      out.put(uint32_t(macro_set.sources.size()));
+      for(auto &source : macro_set.sources) out.put_str(source.first), out.put(uint64_t(source.second));
+      out.put(uint32_t(macro_set.aliases.size()));
+      for(auto &alias : macro_set.aliases) {
+        out.put_str(alias.cpp_key);
+        alias.program.serialize(out);
+        out.put(uint32_t(alias.prefixes.size()));
+        for(auto &prefix : alias.prefixes) out.put_str(prefix.type), out.put_str(prefix.token);
+      }
+
+      error_code ec;
+      filesystem::create_directories(macro_cache_dir, ec);
+      const string cache_file = macro_cache_file(hash), temp_file = cache_file + ".tmp" + to_string(random_device{}());
+      ofstream write_file(temp_file, ios::binary);
+      if(write_file.is_open() && write_file.write(out.bytes.data(), out.bytes.size()) && (write_file.close(), !write_file.fail()))
+        filesystem::rename(temp_file, cache_file, ec);
+      else
+        ec = make_error_code(errc::io_error);
+      if(ec) {
+        filesystem::remove(temp_file, ec);
+        if(show_info) cerr << "-:- couldn't cache \"" << cache_file << "\" -:-" << endl;
+      }
+    }
+
+
+    void refresh_anchors() {
+      if(!anchors_stale) return;
+      script_anchors = AnchorSet();
+      script_anchor_ids.assign(script_programs.size(), -1);
+      for(std::size_t i = 0; i < script_programs.size(); ++i)
+        if(auto anchor = script_programs[i].anchor())
+          script_anchor_ids[i] = script_anchors.add(*anchor);
+      script_anchors.build();
+      script_profile_slots.clear();
+      anchors_stale = false;
+    }
+
+    void refresh_profile_slots() {
+      if(!profile || script_profile_slots.size() == script_syntax.size()) return;
+      script_profile_slots.clear();
+      for(std::size_t i = 0; i < script_syntax.size(); ++i)
+        script_profile_slots.push_back(profile->slot(profile_label(i), script_syntax[i].first));
+    }
+    string profile_label(std::size_t i) const {
+      return script_programs[i].empty() ? "(regex)" : script_programs[i].syntax_source();
+    }
+
+    // Carry anchor hits across 1 alias's rewrite: shift those in untouched text,
+    // drop those overlapping a replaced match, & rescan only around expansions
+    void update_anchor_hits(MappingScratch &scratch, const string &text) {
+      AnchorHits &hits = scratch.anchor_hits;
+      const std::vector<Edit> &edits = scratch.edits;
+      for(unsigned id = 0; id < hits.size(); ++id) {
+        const std::size_t anchor_size = script_anchors.anchor(id).size();
+        std::size_t edit = 0, kept = 0;
+        long long shift = 0;
+        for(std::size_t p : hits[id]) {
+          for(; edit < edits.size() && edits[edit].old_end <= p; ++edit)
+            shift += (long long)edits[edit].new_size - (long long)(edits[edit].old_end - edits[edit].old_begin);
+          if(edit < edits.size() && edits[edit].old_begin < p + anchor_size) continue;
+          hits[id][kept++] = std::size_t(p + shift);
+        }
+        hits[id].resize(kept);
+      }
+
+      AnchorHits &added = scratch.added_hits;
+      added.resize(hits.size());
+      for(auto &more : added) more.clear();
+      const std::size_t reach = script_anchors.longest_anchor() - 1;
+      for(auto &e : edits) // new hits overlap an expansion (or straddle the seam of an empty one)
+        script_anchors.scan(text, e.new_begin > reach ? e.new_begin - reach : 0, e.new_begin + e.new_size,
+          [&](unsigned id, std::size_t p) {
+            if(p + script_anchors.anchor(id).size() > e.new_begin) added[id].push_back(p);
+          });
+      for(unsigned id = 0; id < hits.size(); ++id) {
+        if(added[id].empty()) continue;
+        std::sort(added[id].begin(), added[id].end());
+        std::vector<std::size_t> &merged = scratch.merged_hits;
+        merged.clear();
+        std::merge(hits[id].begin(), hits[id].end(), added[id].begin(), added[id].end(), std::back_inserter(merged));
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        hits[id].swap(merged);
+      }
+    }
+
+    // The "#defmac"/"#defmac_include" directive at "p" of "text", matched like
+    // "parse_defmac_macros"'s regexes: its end if found, "npos" if "p" holds
+    // none (w/ "examined" == the last position that decided so), or 0 if
+    // "text" ends before telling (& "at_eof" is false)
+    static std::size_t directive_end(std::string_view text, std::size_t p, bool at_eof, std::size_t &examined) {
+      constexpr auto npos = std::string_view::npos;
+      const std::size_t n = text.size();
+      const bool include = text.compare(p, 15, "#defmac_include") == 0;
+      std::size_t q = p + (include ? 15 : 7);
+      while(q < n && std::isspace(static_cast<unsigned char>(text[q]))) ++q;
+      examined = q;
+      if(q == n) return at_eof ? npos : 0;
+      if(text[q] != '`') return npos;
+      if(include) { // `(.+)`: greedy up to the line's last '`'
+        static const ByteSet line_ends("\n\r");
+        std::size_t line_end = line_ends.find(text, q+1);
+        if(line_end == npos && !at_eof) return 0;
+        if(line_end == npos) line_end = n;
+        const std::size_t last = text.substr(0, line_end).rfind('`');
+        examined = line_end;
+        return last >= q+2 ? last+1 : npos;
+      }
+      // `((.|\n)+?)`((.|\n)+?)`: neither defn may hold a '\r'
+      static const ByteSet defn_ends("`\r");
+      const std::size_t syntax_end = q+2 <= n ? defn_ends.find(text, q+2) : npos;
+      const std::size_t cpp_end = syntax_end == npos || syntax_end+2 > n ? npos : defn_ends.find(text, syntax_end+2);
+      examined = n;
+      if(cpp_end == npos) return at_eof ? npos : 0;
+      for(std::size_t r : {q+1, syntax_end, syntax_end+1, cpp_end})
+        if(text[r] == '\r') return examined = r, npos;
+      return cpp_end+1;
+    }
+
+    // 1st "#defmac_include" (if "include") or "#defmac" directive in "buffer" at or
+    // after "from", as [begin,end) (begin == npos if none): each one that doesn't
+    // parse is logged to "failed" w/ how far it looked
+    static std::pair<std::size_t,std::size_t> find_directive(std::string_view buffer, std::size_t from, bool include, 
+                                                             std::vector<std::pair<std::size_t,std::size_t>> &failed) {
+      constexpr auto npos = std::string_view::npos;
+      for(std::size_t p = from;; ++p) {
+        p = find_literal(buffer, include ? "#defmac_include" : "#defmac", p);
+        if(p == npos) return {npos, npos};
+        std::size_t examined = p + 7, end = npos;
+        if(include || buffer.compare(p, 15, "#defmac_include") != 0) end = directive_end(buffer, p, true, examined);
+        if(end != npos) return {p, end};
+        failed.emplace_back(p, examined);
+      }
+    }
+
+    // Where to resume "find_directive" once the directive at "begin" was erased: 
+    // before any directive it might now complete (1 straddling the seam, or a 
+    // failed 1 that looked past "begin"), dropping the failures to be re-found
+    static std::size_t rescan_from(std::size_t begin, std::vector<std::pair<std::size_t,std::size_t>> &failed) {
+      std::size_t from = begin - std::min(begin, std::size_t(14)); // ("#defmac_include" - 1)
+      for(auto &failure : failed)
+        if(failure.second >= begin) {
+          from = std::min(from, failure.first);
+          break;
+        }
+      while(!failed.empty() && failed.back().first >= from) failed.pop_back();
+      return from;
+    }
+
+    // The file a "#defmac_include `(.+)`" directive names
+    static string included_filename(std::string_view directive) {
+      const std::size_t name_begin = directive.find('`')+1;
+      return string(directive.substr(name_begin, directive.size() - name_begin - 1));
+    }
+
+    // Cut each "#defmac_include" (if "include") or "#defmac" directive out of 
+    // "buffer" as if erasing it & resuming at "rescan_from", passing each to
+    // "on_directive" (a view into "buffer": don't keep it). W/o the erases: the
+    // cuts' gap is carried along (== buffer[0,kept) + buffer[tail,end)) & only
+    // the text to rescan moves back behind it, so this is linear in "buffer"
+    // (+ rescans) rather than 1 copy of the rest of "buffer" per directive.
+    template <typename OnDirective>
+    static void cut_directives(string &buffer, bool include, OnDirective on_directive) {
+      std::vector<std::pair<std::size_t,std::size_t>> failed; // (w/o the gap)
+      std::size_t kept = 0, tail = 0;
+      for(;;) {
+        const std::size_t logged = failed.size();
+        const auto found = find_directive(std::string_view(buffer).substr(tail), 0, include, failed);
+        for(std::size_t i = logged; i < failed.size(); ++i) failed[i].first += kept, failed[i].second += kept;
+        if(found.first == std::string_view::npos) break;
+        std::memmove(&buffer[kept], &buffer[tail], found.first); // close the gap up to the directive
+        kept += found.first;
+        on_directive(std::string_view(buffer).substr(tail + found.first, found.second - found.first));
+        tail += found.second;
+        const std::size_t from = rescan_from(kept, failed), rescanned = kept - from;
+        std::memmove(&buffer[tail - rescanned], &buffer[from], rescanned); // reopen it before the rescan
+        kept = from, tail -= rescanned;
+      }
+      std::memmove(&buffer[kept], &buffer[tail], buffer.size() - tail);
+      buffer.resize(kept + buffer.size() - tail);
+    }
+
+    static bool is_word(char c) {return std::isalnum(static_cast<unsigned char>(c)) || c == '_';}
+
+    // "$<type>token" -> "/*n*/$token" in 1 pass ("n" == "count"++, keeping the C++ 
+    // defns apart once their <type>s are distributed), logging each to "prefixed"
+    static string strip_type_prefixes(const string &cpp_key, int &count, std::vector<type_prefix_data> &prefixed) {
+      string stripped;
+      stripped.reserve(cpp_key.size() + 8);
+      for(std::size_t i = 0; i < cpp_key.size();) {
+        std::size_t type_end = i+2, token_end = 0;
+        if(cpp_key.compare(i, 2, "$<") == 0) {
+          while(type_end < cpp_key.size() && is_word(cpp_key[type_end])) ++type_end;
+          if(type_end > i+2 && type_end < cpp_key.size() && cpp_key[type_end] == '>')
+            for(token_end = type_end+1; token_end < cpp_key.size() && is_word(cpp_key[token_end]);) ++token_end;
+        }
+        if(token_end <= type_end+1) { // not a "$<\w+>\w+"
+          stripped += cpp_key[i++];
+          continue;
+        }
+        const string token = '$' + cpp_key.substr(type_end+1, token_end-type_end-1);
+        prefixed.emplace_back(cpp_key.substr(i+2, type_end-i-2), token);
+        ((stripped += "/*") += std::to_string(count++)) += "*/";
+        stripped += token;
+        i = token_end;
+      }
+      return stripped;
+    }
+
+    // Each whole "$var" of "variables" in "cpp_key" -> "\v{n}" (n == 2*index+1, its capture slot's group)
+    static string number_variables(const string &cpp_key, const std::vector<string> &variables) {
+      string numbered;
+      numbered.reserve(cpp_key.size());
+      for(std::size_t i = 0; i < cpp_key.size();) {
+        std::size_t token_end = i+1;
+        while(cpp_key[i] == '$' && token_end < cpp_key.size() && is_word(cpp_key[token_end])) ++token_end;
+        const auto variable = token_end == i+1 ? variables.end() : std::find_if(variables.begin(), variables.end(), 
+          [&](const string &var) {return cpp_key.compare(i, token_end-i, var) == 0;});
+        if(variable == variables.end()) {
+          numbered.append(cpp_key, i, token_end-i);
+        } else {
+          numbered += "\\v" + std::to_string(2*(variable - variables.begin())+1);
+        }
+        i = token_end;
+      }
+      return numbered;
+    }
+
+    // Gather the directives in "text" (starting at input offset "offset") into
+    // "directives" & "directives_buffer" (each + '\n'): returns how much of "text"
+    // is done w/ (the rest may hold the start of a directive, if not "at_eof").
+    // "clean" is cleared if a directive holds another "#defmac", or starts w/in
+    // what a failed "#defmac" examined: "parse_defmac_macros" rescans after each
+    // removal, so only clean texts are certain to lose the very same directives.
+    static std::size_t gather_directives(std::string_view text, std::size_t offset, bool at_eof, 
+                                         std::vector<std::pair<std::size_t,std::size_t>> &directives, 
+                                         string &directives_buffer, bool &clean) {
+      std::size_t p = 0, scanned = 0, failed_reach = 0, examined = 0;
+      bool failed = false;
+      for(;;) {
+        p = find_literal(text, "#defmac", p);
+        if(p == std::string_view::npos) return std::max(scanned, text.size() - std::min(text.size(), std::size_t(6)));
+        const std::size_t end = directive_end(text, p, at_eof, examined);
+        if(!end) return p; // directive may continue in the next read
+        if(end == std::string_view::npos) {
+          failed_reach = std::max(failed_reach, examined), failed = true;
+          ++p;
+          continue;
+        }
+        if((failed && p <= failed_reach) || text.substr(p+1, end-p-1).find("#defmac") != std::string_view::npos) clean = false;
+        directives.emplace_back(offset + p, offset + end);
+        directives_buffer.append(text.substr(p, end-p)) += '\n';
+        p = scanned = end;
+      }
+    }
+
+    // Writes to "out", trimming '\n' runs > 2 down to 2 across writes (like "map_file")
+    struct NewlineTrimmingWriter {
+      std::ostream &out;
+      unsigned      newlines = 0; // length of the '\n' run written last
+      void write(std::string_view text) {
+        std::string trimmed;
+        trimmed.reserve(text.size());
+        append_trimming_newlines(trimmed, text, newlines);
+        out.write(trimmed.data(), trimmed.size());
+      }
+    };
+
+    // Append "text" to "out", trimming runs of > 2 '\n' down to 2
+    // ("newlines": the length of the '\n' run "out" ends w/, carried across calls)
+    static void append_trimming_newlines(string &out, std::string_view text, unsigned &newlines) {
+      for(std::size_t p = 0; p < text.size();) {
+        if(text[p] == '\n') {
+          if(++newlines <= 2) out += '\n';
+          ++p;
+          continue;
+        }
+        const std::size_t stop = std::min(text.find('\n', p), text.size());
+        out.append(text.substr(p, stop - p));
+        newlines = 0, p = stop;
+      }
+    }
+
+    // Whether every alias maps lines independently: #defmac's w/o a '\n' (their
+    // $vars never cross lines) & no lexing (a comment's state spans lines)
+    bool maps_line_local() const {
+      if(code_only) return false;
+      for(auto &program : script_programs) if(program.empty() || program.spans_lines()) return false;
+      return true;
+    }
+
+    // What mapping depends on: each alias's matcher, C++ key, & distributed types
+    string alias_signature() const {
+      string signature(1, char(code_only));
+      for(std::size_t i = 0; i < script_syntax.size(); ++i) {
+        signature += (script_programs[i].empty() ? "(regex)" : script_programs[i].regex_source()) + '\0' + script_syntax[i].first + '\0';
+        for(auto &segment : script_templates[i].segments) signature += segment.type_prefix + '\0';
+      }
+      return signature;
+    }
+
+    // Map "body"[begin,end) (both at line starts) onto "output", indexing each 
+    // ~16KB chunk of lines in "spans" (1 chunk if lines don't map independently)
+    void map_spans(const string &body, std::size_t begin, std::size_t end, string &output, std::vector<MappedSpan> &spans) {
+      constexpr std::size_t chunk_size = 16 * 1024;
+      const bool line_local = maps_line_local();
+      for(std::size_t p = begin; p < end;) {
+        std::size_t stop = end;
+        if(line_local && end - p > chunk_size) {
+          const std::size_t nl = body.find('\n', p + chunk_size);
+          if(nl < end) stop = nl+1;
+        }
+        string chunk = body.substr(p, stop - p);
+        apply_aliases(chunk);
+        spans.push_back(MappedSpan{p, stop, output.size(), output.size() + chunk.size()});
+        output += chunk;
+        p = stop;
+      }
+    }
+
+    // Re-map only the spans of "state" that differ from "body" (its lines map
+    // independently): the edit spans [common prefix, body.size() - common suffix),
+    // widened to the indexed spans holding it & to whole lines
+    std::size_t remap_edited_spans(const string &body, IncrementalState &state) {
+      using namespace std;
+      const string &old_body = state.body;
+      auto &spans = state.spans;
+      size_t prefix = 0, suffix = 0;
+      const size_t common = min(old_body.size(), body.size());
+      while(prefix < common && old_body[prefix] == body[prefix]) ++prefix;
+      while(suffix < common - prefix && old_body[old_body.size()-1-suffix] == body[body.size()-1-suffix]) ++suffix;
+      if(prefix == old_body.size() && prefix == body.size()) return 0;
+
+      auto span_holding = [&](size_t p) { // last span if "p" is past the end
+        return size_t(upper_bound(spans.begin(), spans.end(), p, [](size_t q, const MappedSpan &s) {return q < s.in_end;}) - spans.begin());
+      };
+      const long long delta = (long long)body.size() - (long long)old_body.size();
+      const size_t old_end = old_body.size() - suffix;
+      size_t first = min(span_holding(prefix), spans.size()-1);
+      size_t last  = old_end > prefix ? min(span_holding(old_end-1), spans.size()-1) : first;
+      last = max(last, first);
+      // a removed '\n' joins the next span's 1st line: take it too
+      while(last+1 < spans.size() && body[size_t(spans[last].in_end + delta) - 1] != '\n') ++last;
+
+      const size_t begin = spans[first].in_begin, end = size_t(spans[last].in_end + delta);
+      string output;
+      vector<MappedSpan> edited;
+      map_spans(body, begin, end, output, edited);
+      const size_t out_begin = spans[first].out_begin, out_end = spans[last].out_end;
+      const long long out_delta = (long long)output.size() - (long long)(out_end - out_begin);
+      for(auto &span : edited) span.out_begin += out_begin, span.out_end += out_begin;
+      for(size_t i = last+1; i < spans.size(); ++i) {
+        spans[i].in_begin  = size_t(spans[i].in_begin + delta),      spans[i].in_end  = size_t(spans[i].in_end + delta);
+        spans[i].out_begin = size_t(spans[i].out_begin + out_delta), spans[i].out_end = size_t(spans[i].out_end + out_delta);
+      }
+      state.output.replace(out_begin, out_end - out_begin, output);
+      spans.erase(spans.begin() + first, spans.begin() + last + 1);
+      spans.insert(spans.begin() + first, edited.begin(), edited.end());
+      return end - begin;
+    }
+
+
     // Confirm the given file object opened properly
     template<typename T>
     void confirmFileIsOpen(const T &fp, const string &filename) {
+      if(!fp.is_open() && throw_on_error)
+        throw std::runtime_error("couldn't open file \"" + filename + "\"!");
       if(!fp.is_open()) {
         std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
                   << ":\033[31m ERROR:\033[0m\033[1m couldn't open file \"" 
@@ -138,6 +2326,129 @@ namespace DEF_MAC {
       }
     }
 
+    // Confirm all of "filename" was written (ie no ENOSPC/EIO mid-write)
+    void confirmFileIsWritten(bool written, const string &filename) {
+      if(!written && throw_on_error)
+        throw std::runtime_error("couldn't write file \"" + filename + "\"!");
+      if(!written) {
+        std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
+                  << ":\033[31m ERROR:\033[0m\033[1m couldn't write file \"" 
+                  << filename << "\"!\033[0m\n-:- Terminating Program -:-\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    // Confirm "#defmac_include"ing "key" doesn't close a cycle of includes in "chain"
+    void confirmIncludeIsAcyclic(const std::vector<string> &chain, const string &key) {
+      auto cycle_start = std::find(chain.begin(), chain.end(), key);
+      if(cycle_start == chain.end()) return;
+      string cycle;
+      for(auto it = cycle_start; it != chain.end(); ++it) cycle += "\"" + *it + "\" -> ";
+      cycle += "\"" + key + "\"";
+      if(throw_on_error) throw std::runtime_error("#defmac_include cycle: " + cycle + "!");
+      std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
+                << ":\033[31m ERROR:\033[0m\033[1m #defmac_include cycle: " 
+                << cycle << "!\033[0m\n-:- Terminating Program -:-\n";
+      std::exit(EXIT_FAILURE);
+    }
+
+    // Write "output" to "filename", unless "write_if_changed" & it already holds it
+    void write_output(const string &filename, std::string_view output) {
+      if(write_if_changed && file_holds(filename, {output})) return;
+      std::ofstream write_file(filename.c_str());
+      confirmFileIsOpen(write_file, filename);
+      write_file.write(output.data(), output.size());
+      write_file.close(); // (flushes: ie ENOSPC shows up here)
+      confirmFileIsWritten(bool(write_file), filename);
+    }
+
+    // Swap temp file "temp_filename" in for "write_filename" (dropping it instead 
+    // if "write_if_changed" & both hold the same bytes)
+    void replace_output(const string &temp_filename, const string &write_filename) {
+      if(temp_filename == write_filename) return;
+      std::error_code ec;
+      if(write_if_changed && files_match(temp_filename, write_filename)) {
+        std::filesystem::remove(temp_filename, ec);
+        return;
+      }
+      std::filesystem::rename(temp_filename, write_filename, ec);
+      if(ec) std::filesystem::remove(temp_filename, ec);
+    }
+
+    // Write "dependency_file" (if set): a make rule w/ "write_filename" depending on
+    // "read_filename" & every file it "#defmac_include"d, plus an empty rule per 
+    // include (like gcc's "-MD -MP": deleting 1 doesn't break the build)
+    void write_dependency_file(const string &read_filename, const string &write_filename) {
+      if(dependency_file.empty()) return;
+      auto escaped = [](const string &path) {
+        string out;
+        for(char c : path) {
+          if(c == ' ' || c == '#') out += '\\';
+          else if(c == '$') out += '$';
+          out += c;
+        }
+        return out;
+      };
+      string rule = escaped(write_filename) + ':';
+      if(read_filename != write_filename) rule += ' ' + escaped(read_filename);
+      for(auto &include : included_files) rule += " \\\n  " + escaped(include);
+      rule += '\n';
+      for(auto &include : included_files) rule += '\n' + escaped(include) + ":\n";
+      write_output(dependency_file, rule);
+    }
+
+    // "file_time_budget"'s deadline for the file being mapped (& its name, for reports)
+    std::chrono::steady_clock::time_point mapping_deadline = std::chrono::steady_clock::time_point::max();
+    string mapping_filename;
+
+    // Names the file being mapped & starts "file_time_budget"'s clock, unless 
+    // already mapping 1 (ie map_file => map_source)
+    class FileBudget {
+      Script &script;
+      bool    started = false;
+    public:
+      FileBudget(Script &mapping, const string &filename) : script(mapping) {
+        using namespace std::chrono;
+        if(!script.mapping_filename.empty() || script.mapping_deadline != steady_clock::time_point::max()) return;
+        if(script.file_time_budget > 0)
+          script.mapping_deadline = steady_clock::now() + duration_cast<steady_clock::duration>(duration<double>(script.file_time_budget));
+        script.mapping_filename = filename, started = true;
+      }
+      ~FileBudget() {if(started) script.mapping_deadline = std::chrono::steady_clock::time_point::max(), script.mapping_filename.clear();}
+    };
+
+    // Where alias "i" ran over a budget: the alias, & "buffer"'s text at "offset"
+    // (offsets are into the text being mapped: the file, or the chunk of its lines
+    // being mapped, less its directives & as rewritten by the aliases above "i")
+    string budget_site(std::size_t i, const string &buffer, std::size_t offset) const {
+      const string alias = script_programs[i].empty() ? "regex alias for `" + script_syntax[i].first + '`' 
+                                                      : '`' + script_programs[i].syntax_source() + '`';
+      const std::size_t line_end = std::min(buffer.find('\n', offset), buffer.size());
+      const std::size_t excerpt_size = std::min<std::size_t>(line_end - std::min(offset, line_end), 40);
+      return alias + " at " + (mapping_filename.empty() ? string() : '"' + mapping_filename + "\" ") + "offset " 
+             + std::to_string(offset) + " (\"" + buffer.substr(std::min(offset, buffer.size()), excerpt_size) 
+             + (offset + excerpt_size < line_end ? "..." : "") + "\")";
+    }
+
+    // Confirm mapping hasn't run past "file_time_budget" (alias "i" about to search "buffer" at "offset")
+    void confirmWithinTimeBudget(std::size_t i, const string &buffer, std::size_t offset, bool overran = false) {
+      if(!overran && (mapping_deadline == std::chrono::steady_clock::time_point::max() || std::chrono::steady_clock::now() < mapping_deadline)) return;
+      const string message = "mapping ran over its " + std::to_string(file_time_budget) + "s budget in " + budget_site(i, buffer, offset) + '!';
+      if(throw_on_error) throw std::runtime_error(message);
+      std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
+                << ":\033[31m ERROR:\033[0m\033[1m " << message << "\033[0m\n-:- Terminating Program -:-\n";
+      std::exit(EXIT_FAILURE);
+    }
+
+    // Warn that alias "i" skipped "hits" match attempts over "match_step_budget", the 1st at "offset"
+    void report_budget_hits(std::size_t i, const string &buffer, std::size_t hits, std::size_t offset) const {
+      static std::mutex report_mutex; // chunk workers share "budget_reports"
+      const string report = "-:- skipped " + std::to_string(hits) + " match attempt(s) over the " + std::to_string(match_step_budget) 
+                            + "-step budget: 1st was " + budget_site(i, buffer, offset) + " -:-\n";
+      std::lock_guard<std::mutex> lock(report_mutex);
+      *budget_reports << report;
+    }
+
 
 
   public:
@@ -146,16 +2457,79 @@ namespace DEF_MAC {
     Script(const SyntaxMap custom_script_syntax_map, const PrefixVector file_prefix_vect = {}) {
       script_syntax = custom_script_syntax_map;
       file_prefixes = file_prefix_vect;
+      script_programs.resize(script_syntax.size());
+      for(auto &alias : script_syntax) script_templates.push_back(compile_replacement(alias.first));
     }
     // CTOR given only a file prefix vector
     Script(const PrefixVector file_prefix_vect) {file_prefixes = file_prefix_vect;}
-    bool show_info = false;
+    bool   show_info = false;
+    bool   throw_on_error = false; // throw std::runtime_error rather than exiting (ie when serving)
+    bool   code_only = false;      // lexer-aware: never match w/in comments or string/char literals
+    string macro_cache_dir; // cache compiled "#defmac_include" files here (empty == no cache)
+    std::size_t max_match_span = 4096; // "stream_file": longest match of any alias spanning lines
+    std::shared_ptr<MacroProfile> profile; // per-alias costs (if set), shared w/ copies of this Script
+    unsigned map_threads = 0; // threads mapping 1 big buffer's chunks of lines (0 == all cores)
+    bool   write_if_changed = false; // leave outputs that'd get the same bytes untouched (& their mtimes)
+    string dependency_file;          // also write a make rule here: output <- input & its includes
+    std::vector<string> included_files; // the last parsed buffer's "#defmac_include"d files (transitively, once each)
+    std::uint64_t match_step_budget = 0; // backtracking steps 1 match attempt may take (0 == no cap): those over it are skipped & reported
+    double        file_time_budget = 0;  // seconds mapping 1 file may take (0 == no cap): running over it is an error naming the alias & offset
+    std::ostream *budget_reports = &std::cerr; // where skipped match attempts are reported (ie a "--serve" reply)
+
+    // Compile each "#defmac_include"d file once for this Script & all its later
+    // copies (which may then map files concurrently), rather than once per file
+    // => "revalidate" recompiles any whose files have since changed (ie resident sets)
+    void share_macro_sets(bool revalidate = false) {
+      if(!shared_macro_sets || shared_macro_sets->revalidate != revalidate) 
+        shared_macro_sets = std::make_shared<MacroSetStore>(revalidate);
+    }
+
+    // $DEFMAC_CACHE_DIR, else $XDG_CACHE_HOME/defmac, else $HOME/.cache/defmac
+    static string default_macro_cache_dir() {
+      if(const char *dir = std::getenv("DEFMAC_CACHE_DIR")) return dir;
+      if(const char *dir = std::getenv("XDG_CACHE_HOME"))   return string(dir) + "/defmac";
+      if(const char *dir = std::getenv("HOME"))             return string(dir) + "/.cache/defmac";
+      return ".defmac_cache";
+    }
 
 
     // Push members
     // NOTE: 2 push aliases, 1 if given a script syntax regex & the other a script syntax string
-    void push_alias(const string cpp_key, const regex script_syntax_val)  {script_syntax.push_back(CppAlias(cpp_key, script_syntax_val));}
-    void push_alias(const string cpp_key, const string script_syntax_val) {regex reg(script_syntax_val); push_alias(cpp_key, reg);}
+    void push_alias(const string cpp_key, const regex script_syntax_val)  {
+      script_syntax.push_back(CppAlias(cpp_key, script_syntax_val));
+      script_programs.emplace_back();
+      script_templates.push_back(compile_replacement(cpp_key));
+      anchors_stale = true;
+    }
+    void push_alias(const string cpp_key, const string script_syntax_val) {
+      const auto compile_start = MacroProfile::Clock::now();
+      regex reg(script_syntax_val);
+      push_alias(cpp_key, reg);
+      if(profile) {
+        MacroProfile::Stats compiled;
+        compiled.compile_seconds = MacroProfile::seconds_since(compile_start);
+        profile->add(profile->slot("(regex)", cpp_key), compiled);
+      }
+    }
+    // Push a #defmac-syntax alias (ie "$base ** $exp") compiled to a MacroProgram
+    void push_defmac_alias(const string cpp_key, const MacroProgram program, const std::vector<type_prefix_data> &prefixes = {}) {
+      script_syntax.push_back(CppAlias(cpp_key, regex()));
+      script_programs.push_back(program);
+      script_templates.push_back(compile_replacement(cpp_key, prefixes));
+      anchors_stale = true;
+    }
+    // Push #defmac's compiled ahead of time (ie "defmac --emit-matcher"'s header),
+    // skipping their parsing & compilation: only matching is left for runtime
+    template <std::size_t N>
+    void push_static_macros(const StaticDefmac (&macros)[N]) {
+      for(auto &macro : macros) push_static_macro(macro);
+    }
+    void push_static_macro(const StaticDefmac &macro) {
+      DefmacAlias alias{string(macro.cpp_key), MacroProgram::from_static(macro.program), {}};
+      for(std::size_t i = 0; i < macro.prefix_count; ++i)
+        alias.prefixes.emplace_back(string(macro.prefixes[i].type), string(macro.prefixes[i].token));
+      register_defmac(alias);
+    }
     void push_prefix(const string prefix) {file_prefixes.push_back(prefix);}
 
 
@@ -163,7 +2537,10 @@ namespace DEF_MAC {
     bool pop_cpp_alias(const string cpp_key) {
       for(auto e = script_syntax.begin(); e != script_syntax.end(); ++e)
         if(e->first == cpp_key) {
+          script_programs.erase(script_programs.begin() + (e - script_syntax.begin()));
+          script_templates.erase(script_templates.begin() + (e - script_syntax.begin()));
           script_syntax.erase(e);
+          anchors_stale = true;
           return true;
         }
       return false;
@@ -179,9 +2556,9 @@ namespace DEF_MAC {
 
 
     // Clear members
-    void clear_alias()  {script_syntax.clear();}
+    void clear_alias()  {script_syntax.clear(), script_programs.clear(), script_templates.clear(), anchors_stale = true;}
     void clear_prefix() {file_prefixes.clear();}
-    void clear()        {script_syntax.clear(), file_prefixes.clear();}
+    void clear()        {clear_alias(), clear_prefix();}
     
 
     // Size members
@@ -190,6 +2567,7 @@ namespace DEF_MAC {
 
 
     // Begin & end members
+    // => #defmac aliases' regexes are left empty (matched by their MacroProgram)
     SyntaxIterator alias_begin()  {return script_syntax.begin();}
     SyntaxIterator alias_end()    {return script_syntax.end();}
     PrefixIterator prefix_begin() {return file_prefixes.begin();}
@@ -197,7 +2575,14 @@ namespace DEF_MAC {
 
 
     // Return COPIES of data container members
-    SyntaxMap    syntax() const {return script_syntax;}
+    // => #defmac aliases' regexes are only built here, from their compiled programs
+    SyntaxMap syntax() const {
+      SyntaxMap syntax_copy(script_syntax);
+      for(std::size_t i = 0; i < syntax_copy.size(); ++i)
+        if(!script_programs[i].empty())
+          syntax_copy[i].second = regex(script_programs[i].regex_source());
+      return syntax_copy;
+    }
     PrefixVector prefix() const {return file_prefixes;}
 
 
@@ -210,311 +2595,1446 @@ namespace DEF_MAC {
     void map_file(const string read_filename, string write_filename = "", bool clusterHeaders = false) {
       using namespace std;
       if(write_filename.empty()) write_filename = read_filename;
+      FileBudget budget(*this, read_filename);
+#ifdef DEFMAC_POSIX
+      if(!clusterHeaders && !show_info) { // zero-copy (-l keeps the in-memory path's stats)
+        MappedFile input(read_filename);
+        if(input.is_open() && map_mapped_file(input.view(), read_filename, write_filename))
+          return write_dependency_file(read_filename, write_filename);
+      }
+#endif
       ifstream read_file(read_filename.c_str());
       confirmFileIsOpen(read_file, read_filename);
       string scriptBuffer = {istreambuf_iterator<char>(read_file), istreambuf_iterator<char>{}}; // slurp file
-      string convertedBuffer = map_buffer(scriptBuffer); // convert every syntax-map val to their respective C++ key
       read_file.close();
+      const string convertedBuffer = map_source(scriptBuffer, clusterHeaders);
+      write_output(write_filename, convertedBuffer);
+      write_dependency_file(read_filename, write_filename);
+    }
+
 
-      convertedBuffer = merge_container_strings(file_prefixes) + convertedBuffer;
-      if(clusterHeaders)
-        convertedBuffer = cluster_buffer_headers(convertedBuffer);
+    // Map a whole source file's contents exactly as "map_file" writes them:
+    // aliases applied, prefixed, headers optionally clustered, & '\n' runs trimmed
+    string map_source(const string &buffer, bool clusterHeaders = false) {
+      using namespace std;
+      string convertedBuffer = map_framed_buffer(buffer, true); // convert every syntax-map val to their respective C++ key (after the prefixes)
+      if(clusterHeaders) // (trims '\n' runs as it clusters)
+        return cluster_headers(convertedBuffer, true);
 
       // trim down sequences > 2 '\n' down to just 2 '\n'
-      const regex multi_newlines(R"(\n{3,})");
-      convertedBuffer = regex_replace(convertedBuffer, multi_newlines, "\n\n"); 
-      
-      ofstream write_file(write_filename.c_str());
-      confirmFileIsOpen(write_file, write_filename);
-      write_file << convertedBuffer;
+      string trimmedBuffer;
+      trimmedBuffer.reserve(convertedBuffer.size());
+      unsigned newlines = 0;
+      append_trimming_newlines(trimmedBuffer, convertedBuffer, newlines);
+      return trimmedBuffer;
+    }
+
+
+    // Map "read_filename" to "write_filename" like "map_file" (minus header clustering),
+    // but in bounded memory: "#defmac"s are gathered in a 1st pass, then the
+    // rest is mapped in line-aligned windows written out as they're done.
+    // => windows are cut at '\n's no match can straddle (nor, if "code_only", a
+    //    comment or literal), so aliases that never match across lines (ie
+    //    any #defmac w/o a '\n') map exactly as they would in 1 buffer
+    // => each alias that can match across lines (hand-written regexes too)
+    //    adds 2*"max_match_span" bytes of lookahead, exact so long as none of
+    //    its matches (nor the lines they end on) exceed "max_match_span" bytes
+    // => peak memory ~ the window (>= 1MB) + lookahead + the longest line
+    void stream_file(const string read_filename, string write_filename = "") {
+      using namespace std;
+      if(write_filename.empty()) write_filename = read_filename;
+      FileBudget budget(*this, read_filename);
+      const size_t read_size = 1 << 16;
+
+      // pass 1: parse out the "#defmac"s & note where they are to skip them
+      vector<pair<size_t,size_t>> directives; // [begin,end) input offsets
+      string directives_buffer;
+      {
+        ifstream read_file(read_filename.c_str());
+        confirmFileIsOpen(read_file, read_filename);
+        string window, chunk(read_size, '\0');
+        size_t window_offset = 0;
+        for(bool eof = false; !eof;) {
+          read_file.read(&chunk[0], chunk.size());
+          eof = size_t(read_file.gcount()) < chunk.size();
+          window.append(chunk, 0, size_t(read_file.gcount()));
+          bool clean = true; // (streams can't rescan: unclean "#defmac"s are simply left in place)
+          const size_t keep = gather_directives(window, window_offset, eof, directives, directives_buffer, clean);
+          window.erase(0, keep), window_offset += keep;
+        }
+      }
+      const string defmac_buffer = parse_defmac_macros(directives_buffer);
+
+      // lookahead for aliases that may match across lines
+      size_t lookahead = 0;
+      for(size_t i = 0; i < script_syntax.size(); ++i)
+        if(script_programs[i].empty() || script_programs[i].spans_lines()) lookahead += 2 * max_match_span;
+      const size_t window_size = max(size_t(1) << 20, 4 * lookahead);
+
+      // write to a temp file when editing in place (or to compare w/ the last output)
+      const string temp_filename = same_file(write_filename, read_filename) || write_if_changed ? write_filename + ".tmp" + to_string(random_device{}()) : write_filename;
+      ofstream write_file(temp_filename.c_str());
+      confirmFileIsOpen(write_file, temp_filename);
+      NewlineTrimmingWriter writer{write_file};
+      writer.write(merge_container_strings(file_prefixes));
+      writer.write("/*\n" + defmac_buffer + "*/\n");
+
+      // pass 2: map windows of the directive-free input
+      ifstream read_file(read_filename.c_str());
+      confirmFileIsOpen(read_file, read_filename);
+      string pending, window, chunk(read_size, '\0');
+      size_t offset = 0, next_directive = 0;
+      for(bool eof = false; !eof;) {
+        read_file.read(&chunk[0], chunk.size());
+        const size_t got = size_t(read_file.gcount());
+        eof = got < chunk.size();
+        for(size_t p = 0; p < got;) {
+          while(next_directive < directives.size() && directives[next_directive].second <= offset + p) ++next_directive;
+          if(next_directive < directives.size() && directives[next_directive].first <= offset + p) {
+            p = min(got, directives[next_directive].second - offset);
+            continue;
+          }
+          const size_t stop = next_directive < directives.size() ? min(got, directives[next_directive].first - offset) : got;
+          pending.append(chunk, p, stop - p);
+          p = stop;
+        }
+        offset += got;
+
+        while(!eof && pending.size() >= window_size + lookahead) {
+          // latest cut leaving "lookahead" bytes before the last complete line's end
+          const size_t last_line = pending.rfind('\n');
+          const size_t window_end = lookahead ? last_line + 1 : pending.size();
+          if(last_line == string::npos || window_end < lookahead + 1) break;
+          const CodeMap code_map = code_only ? CodeMap::lex(pending.substr(0, window_end)) : CodeMap();
+          bool cut = false;
+          for(size_t nl = pending.rfind('\n', window_end - lookahead - 1); !cut && nl != string::npos; nl = nl ? pending.rfind('\n', nl-1) : string::npos) {
+            if(code_only && !code_map.is_code(nl, nl+1)) continue;
+            window.assign(pending, 0, lookahead ? window_end : nl+1);
+            size_t tracked = nl+1;
+            apply_aliases(window, &tracked);
+            if(tracked == string::npos) continue; // a match straddles this cut
+            writer.write(string_view(window).substr(0, tracked));
+            pending.erase(0, nl+1);
+            cut = true;
+          }
+          if(!cut) break; // no safe cut yet: read on
+        }
+      }
+      apply_aliases(pending);
+      writer.write(pending);
       write_file.close();
+      replace_output(temp_filename, write_filename);
+      write_dependency_file(read_filename, write_filename);
     }
 
 
-    // Parse #defmac macros from ".dmac" file
-    // Enables keeping language syntax macros consolidated in a single file
-    void parse_dmac_file(const std::string filename) {
+    // "map_file" (minus header clustering), reusing "state" from the last call:
+    // only the spans an edit touches are re-mapped & spliced into the last output
+    // => re-maps in full if the aliases change (ie a "#defmac" is edited), or if 
+    //    they can't map lines independently (ie "code_only"): an edit then has
+    //    no bounded reach. Returns the # of body bytes (re-)mapped.
+    std::size_t remap_file(const string read_filename, string write_filename, IncrementalState &state) {
       using namespace std;
-      if(filename.empty()) return;
-      ifstream read_file(filename.c_str());
-      confirmFileIsOpen(read_file, filename);
-      string scriptBuffer = {istreambuf_iterator<char>(read_file), istreambuf_iterator<char>{}}; // slurp file
-      map_buffer(scriptBuffer); // convert every syntax-map val to their respective C++ key
+      if(write_filename.empty()) write_filename = read_filename;
+      FileBudget budget(*this, read_filename);
+      ifstream read_file(read_filename.c_str(), ios::binary);
+      confirmFileIsOpen(read_file, read_filename);
+      const string input = {istreambuf_iterator<char>(read_file), istreambuf_iterator<char>{}};
       read_file.close();
+
+      // split out the directives (unclean ones need "parse_defmac_macros"'s rescans: map in full)
+      vector<pair<size_t,size_t>> directives;
+      string directives_buffer, body;
+      bool clean = true;
+      gather_directives(input, 0, true, directives, directives_buffer, clean);
+      vector<size_t> seams;
+      size_t from = 0;
+      for(auto &d : directives) body.append(input, from, d.first - from), from = d.second, seams.push_back(body.size());
+      body.append(input, from, string::npos);
+      for(size_t seam : seams) // removals mustn't join a new "#defmac"
+        clean = clean && body.substr(seam - min(seam, size_t(6)), 12).find("#defmac") == string::npos;
+      state.sources.assign(1, read_filename);
+      vector<pair<size_t,size_t>> failed;
+      for(auto found = find_directive(directives_buffer, 0, true, failed); found.first != string::npos; 
+               found = find_directive(directives_buffer, found.second, true, failed))
+        state.sources.push_back(included_filename(string_view(directives_buffer).substr(found.first, found.second - found.first)));
+
+      size_t remapped = body.size();
+      if(!clean) {
+        state.valid = false, state.spans.clear(), state.header.clear(), state.body.clear();
+        state.output = map_source(input);
+      } else {
+        const string defmac_buffer = parse_defmac_macros(directives_buffer);
+        refresh_anchors();
+        const string header = merge_container_strings(file_prefixes) + "/*\n" + defmac_buffer + "*/\n";
+        const string signature = alias_signature();
+        if(!state.valid || state.signature != signature || state.header != header || state.spans.empty()) {
+          state.valid = maps_line_local(); // (else re-mapped in full every time)
+          state.signature = signature, state.header = header;
+          state.output.clear(), state.spans.clear();
+          map_spans(body, 0, body.size(), state.output, state.spans);
+        } else {
+          remapped = remap_edited_spans(body, state);
+        }
+        state.body.swap(body);
+      }
+
+      // write the header & output, trimming '\n' runs (via a temp file when editing in place or comparing)
+      const string temp_filename = same_file(write_filename, read_filename) || write_if_changed ? write_filename + ".tmp" + to_string(random_device{}()) : write_filename;
+      ofstream write_file(temp_filename.c_str(), ios::binary);
+      confirmFileIsOpen(write_file, temp_filename);
+      NewlineTrimmingWriter writer{write_file};
+      writer.write(state.header);
+      writer.write(state.output);
+      write_file.close();
+      replace_output(temp_filename, write_filename);
+      return remapped;
     }
 
 
-    // Given std::string buffer: parses out, regex-ifies, and inserts #defmac
-    // "macros" to the "script_syntax" std::vector of std::pair member. 
-    // Returns std::string of accumulated #defmac "macros" rmvd from buffer.
-    string parse_defmac_macros(string &buffer) {
+#ifdef DEFMAC_POSIX
+    // "map_file" over an mmap'd input, copying only the lines that hold an alias
+    // anchor (plus any joined by a removed directive): the rest is written
+    // straight from the mapping, in 1 gathered write of the input's untouched
+    // spans interleaved w/ the mapped lines' buffers
+    // => lines w/o any anchor can't change, so long as every alias has 1 & 
+    //    can't match across lines: else (or if "code_only" must lex the
+    //    whole file) the directive-free text is mapped as 1 copied buffer
+    // => false (w/o side effects) if its "#defmac"s aren't clean (see
+    //    "gather_directives"): "map_file" then maps it in memory instead
+    bool map_mapped_file(std::string_view input, const string &read_filename, const string &write_filename) {
       using namespace std;
-      using DefMacMap   = vector<pair<string,string>>; 
-      using DefMacAlias = pair<string,string>;
+      vector<pair<size_t,size_t>> directives;
+      string directives_buffer;
+      bool clean = true;
+      gather_directives(input, 0, true, directives, directives_buffer, clean);
+
+      // the directive-free text: "pieces" of "input", "starts[k]" == piece k's logical offset
+      vector<string_view> pieces;
+      size_t from = 0;
+      for(auto &d : directives) pieces.push_back(input.substr(from, d.first - from)), from = d.second;
+      pieces.push_back(input.substr(from));
+      vector<size_t> starts(1, 0);
+      for(auto piece : pieces) starts.push_back(starts.back() + piece.size());
+      const size_t size = starts.back();
 
-      const regex variable_token(R"((\$\w+))");              // '$'-prefixed token regex for defmac var names
-      const regex escaped_var_token(R"((\\\$\w+))");
-      const string regex_control_chars(R"(\^$.*+?()[]{}|)"); // escape these in client landef's
-      string defmac_buffer;                                  // accumulates parsed defmac "macros"
-      string defmac_as_regex;                                // #defmac converted to regex notation 
+      deque<string> mapped_lines; // (deque: stable addresses for the views below)
+      string header;
+      vector<string_view> output;
+      auto emit_input = [&](size_t begin, size_t end) { // logical [begin,end) as views of "input"
+        for(size_t k = 0; k < pieces.size() && begin < end; ++k)
+          if(begin < starts[k+1]) {
+            const size_t stop = min(end, starts[k+1]);
+            output.push_back(pieces[k].substr(begin - starts[k], stop - begin));
+            begin = stop;
+          }
+      };
+      auto copy_input = [&](size_t begin, size_t end) {
+        string text;
+        text.reserve(end - begin);
+        for(size_t k = 0; k < pieces.size(); ++k)
+          if(begin < starts[k+1] && starts[k] < end)
+            text.append(pieces[k].substr(max(begin, starts[k]) - starts[k], min(end, starts[k+1]) - max(begin, starts[k])));
+        return text;
+      };
+
+      for(size_t k = 1; clean && k < pieces.size(); ++k) // removals mustn't join a new "#defmac"
+        clean = copy_input(starts[k] - min(starts[k], size_t(6)), min(size, starts[k] + 6)).find("#defmac") == string::npos;
+      if(!clean) return false;
+      const string defmac_buffer = parse_defmac_macros(directives_buffer);
 
-      DefMacMap defmac_macro_map;       // read #defmac's into this map
-      DefMacMap defmac_macro_regex_map; // write regex-fied #defmac syntax definitions here
+      refresh_anchors();
+      bool line_local = !code_only;
+      for(auto &program : script_programs) line_local = line_local && program.anchor() && !program.spans_lines();
+      header = merge_container_strings(file_prefixes) + "/*\n" + defmac_buffer + "*/\n";
+      output.push_back(header);
+      if(!line_local) {
+        mapped_lines.push_back(copy_input(0, size));
+        apply_aliases(mapped_lines.back());
+        output.push_back(mapped_lines.back());
+      } else {
+        auto piece_of = [&](size_t p) {return size_t(upper_bound(starts.begin(), starts.end(), p) - starts.begin()) - 1;};
+        auto line_begin = [&](size_t p) { // start of the line holding "p"
+          if(!p) return size_t(0);
+          size_t k = piece_of(p-1), off = p - starts[k];
+          for(;;) {
+            const size_t nl = off ? pieces[k].rfind('\n', off-1) : string_view::npos;
+            if(nl != string_view::npos) return starts[k] + nl + 1;
+            if(!k) return size_t(0);
+            off = pieces[--k].size();
+          }
+        };
+        auto line_end = [&](size_t p) { // just past the '\n' ending the line holding "p"
+          if(p >= size) return size;
+          size_t k = piece_of(p), off = p - starts[k];
+          for(;;) {
+            const size_t nl = pieces[k].find('\n', off);
+            if(nl != string_view::npos) return starts[k] + nl + 1;
+            if(++k == pieces.size()) return size;
+            off = 0;
+          }
+        };
 
-      // Parse "#defmac_include" statements to parse premade "#defmac" macros defined
-      // in the "#defmac_include"d external file => #defmac_include `someFile.anyExtension`
-      const regex defmac_include(R"(#defmac_include\s*`(.+)`)");
-      smatch defmac_include_matches;
-      while(regex_search(buffer, defmac_include_matches, defmac_include)) {
-        buffer = defmac_include_matches.prefix().str() + defmac_include_matches.suffix().str();
-        defmac_buffer += defmac_include_matches.str(0) + "\n";
-        parse_dmac_file(defmac_include_matches.str(1));
+        // lines holding anchors, or spanning a removed directive's seam: hot lines
+        // < "merge_gap" apart map as 1 chunk (apply_aliases has a per-call cost)
+        constexpr size_t merge_gap = 16 * 1024;
+        vector<pair<size_t,size_t>> hot;
+        for(size_t k = 0; k < pieces.size(); ++k) {
+          script_anchors.scan(pieces[k], 0, pieces[k].size(), [&](unsigned id, size_t p) {
+            hot.emplace_back(starts[k] + p, starts[k] + p + script_anchors.anchor(id).size());
+          });
+          if(k && starts[k] && starts[k] < size) hot.emplace_back(starts[k]-1, starts[k]+1);
+        }
+        sort(hot.begin(), hot.end());
+        size_t copied = 0;
+        for(size_t i = 0; i < hot.size();) {
+          const size_t begin = line_begin(max(hot[i].first, copied));
+          size_t end = line_end(hot[i].second - 1);
+          for(++i; i < hot.size() && hot[i].first < end + merge_gap; ++i) end = max(end, line_end(hot[i].second - 1));
+          emit_input(copied, begin);
+          mapped_lines.push_back(copy_input(begin, end));
+          apply_aliases(mapped_lines.back());
+          output.push_back(mapped_lines.back());
+          copied = end;
+        }
+        emit_input(copied, size);
       }
 
-      // put each instance of #defmac into map of lang-C++ pairs && remove them from the buffer 
-      const regex language_definition(R"(#defmac(\s*?)`((.|\n)+?)`((.|\n)+?)`)"); // regex for defmac "macro"s
-      smatch defmac_match; 
-      while(regex_search(buffer, defmac_match, language_definition)) {
-        defmac_macro_map.push_back(DefMacAlias(defmac_match.str(2),defmac_match.str(4))); // save #defmac "script : C++" pair
-        defmac_buffer += defmac_match.str(0) + "\n";                        // accumulate defmac "macro"
-        buffer = defmac_match.prefix().str() + defmac_match.suffix().str(); // remove #defmac from buffer        
+      // trim '\n' runs > 2 down to 2 by splitting views around the extra '\n's
+      vector<string_view> trimmed;
+      unsigned newlines = 0;
+      for(auto piece : output) {
+        size_t kept_from = 0, last = string_view::npos;
+        for(size_t i = piece.find('\n'); i != string_view::npos; last = i, i = piece.find('\n', i+1)) {
+          newlines = (last == string_view::npos ? i == 0 : i == last+1) ? newlines+1 : 1;
+          if(newlines <= 2) continue;
+          if(i > kept_from) trimmed.push_back(piece.substr(kept_from, i - kept_from));
+          kept_from = i+1;
+        }
+        if(!piece.empty() && piece.back() != '\n') newlines = 0;
+        if(kept_from < piece.size()) trimmed.push_back(piece.substr(kept_from));
       }
 
+      if(write_if_changed && file_holds(write_filename, trimmed)) return true;
+
+      // in-place edits go through a temp file: truncating "input"'s file would pull the mapping from under us
+      struct WriteFile {
+        int fd;
+        bool is_open() const {return fd >= 0;}
+      };
+      const string temp_filename = same_file(write_filename, read_filename) ? write_filename + ".tmp" + to_string(random_device{}()) : write_filename;
+      WriteFile write_file{::open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)};
+      confirmFileIsOpen(write_file, temp_filename);
+      const bool written = write_gathered(write_file.fd, trimmed);
+      if(::close(write_file.fd) != 0 || !written) { // never rename a short temp file over the output (ie the source w/ -local)
+        if(temp_filename != write_filename) ::unlink(temp_filename.c_str());
+        confirmFileIsWritten(false, write_filename);
+      }
+      replace_output(temp_filename, write_filename);
+      return true;
+    }
+#endif
+
+
+    // 1 buffer's directives, cut out in order: the files it "#defmac_include"s, 
+    // & its own #defmac's compiled (not yet registered)
+    struct ParsedDirectives {
+      string              defmac_buffer; // the directives cut, 1 per line
+      std::vector<string> include_filenames;
+      MacroSet            macros;        // (w/ each alias's compile time)
+    };
+
+    static ParsedDirectives parse_directives(string &buffer) {
+      using namespace std;
+      using DefMacMap   = vector<pair<string,string>>; 
+      using DefMacAlias = pair<string,string>;
+      ParsedDirectives parsed;
+      string &defmac_buffer = parsed.defmac_buffer; // accumulates parsed defmac "macros"
+      DefMacMap defmac_macro_map;                   // read #defmac's into this map
+
+      // Cut "#defmac_include" statements naming files of premade "#defmac" macros
+      // => #defmac_include `someFile.anyExtension`
+      cut_directives(buffer, true, [&](string_view directive) {
+        parsed.include_filenames.push_back(included_filename(directive));
+        defmac_buffer.append(directive) += '\n';
+      });
+
+      // put each instance of #defmac into map of lang-C++ pairs && remove them from the buffer 
+      cut_directives(buffer, false, [&](string_view directive) {
+        const size_t syntax_begin = directive.find('`')+1, syntax_end = directive.find('`', syntax_begin+1);
+        defmac_macro_map.push_back(DefMacAlias(directive.substr(syntax_begin, syntax_end - syntax_begin),   // save #defmac "script : C++" pair
+                                               directive.substr(syntax_end+1, directive.size() - syntax_end - 2)));
+        defmac_buffer.append(directive) += '\n'; // accumulate defmac "macro"
+      });
+
       // store type-prefixed instances of variable tokens to distribute types to later
-      const regex variable_prefix_token(R"((\$<(\w+)>(\w+)))");
       unordered_multimap<string,type_prefix_data> prefixed_token_data; // Filled with instances of prefixed data
-      smatch token_prefix_matches;
+      vector<type_prefix_data> prefixed;
       int count = 0;
-      for(auto &e : defmac_macro_map)
-        while(regex_search(e.second, token_prefix_matches, variable_prefix_token)) {
-          prefixed_token_data.insert(make_pair(e.first,type_prefix_data(token_prefix_matches.str(2),"$"+token_prefix_matches.str(3))));
-          e.second = token_prefix_matches.prefix().str() + 
-                     "/*" + to_string(count++) + "*/" + // comment w/ unique # prevents C++ defn overlaps once <type> distributions rmvd
-                     "$" + token_prefix_matches.str(3) + token_prefix_matches.suffix().str();
-        }
+      for(auto &e : defmac_macro_map) {
+        if(e.second.find("$<") == string::npos) continue;
+        e.second = strip_type_prefixes(e.second, count, prefixed);
+        for(auto &data : prefixed) prefixed_token_data.insert(make_pair(e.first, data));
+        prefixed.clear();
+      }
 
-      // convert defmac "macros" to parsable regex notation
-      int variable_syntax_index = 1;
-      for(auto elt : defmac_macro_map) { 
+      // compile defmac "macros" to matcher programs
+      for(auto &elt : defmac_macro_map) { 
+        const auto compile_start = MacroProfile::Clock::now();
         auto prefixed_token_range = prefixed_token_data.equal_range(elt.first); // iterator withing prefix data map
-        // replace var tokens for C++ syntax equivalent with \v1, \v2, etc
-        variable_syntax_index = 1;
-        for(sregex_iterator it(elt.first.begin(),elt.first.end(),variable_token); it!=sregex_iterator{}; ++it,variable_syntax_index+=2) {
-          // replace the variable name with its "\v{n}" equivalent
+        MacroProgram program = MacroProgram::compile(elt.first);
+
+        // replace var tokens for C++ syntax equivalent with \v1, \v3, etc (ie their program capture slot's regex group)
+        int variable_syntax_index = 1;
+        for(auto &token : program.variable_names()) {
           for(auto prefix_iter = prefixed_token_range.first; prefix_iter != prefixed_token_range.second; ++prefix_iter)
-            if(prefix_iter->second.token == it->str()) {
+            if(prefix_iter->second.token == token) {
               prefix_iter->second.token = R"(\v)" + to_string(variable_syntax_index);
               break;
             }
-          regex specific_var_token_instance(R"((\)" + it->str() + R"(\b))");
-          elt.second = regex_replace(elt.second, specific_var_token_instance, R"(\v)" + to_string(variable_syntax_index)); 
-        }
-
-        // escape all regex control characters in the map's string keys (ie the syntax defn's)
-        defmac_as_regex = elt.first;
-        for(auto letter : regex_control_chars)
-          defmac_as_regex = regex_replace(defmac_as_regex, regex(string(R"(\)") + letter), string(R"(\)") + letter);
-
-        // replace repeating $token names w/ backtracing regex tokens
-        set<string> seen_tokens;
-        string backtraced_buffer(defmac_as_regex);
-        auto token_iter = sregex_iterator(defmac_as_regex.begin(), defmac_as_regex.end(), escaped_var_token);
-        int idx = 1;
-        for(; token_iter != sregex_iterator{}; ++token_iter, idx+=2) {
-          if(seen_tokens.find(token_iter->str()) != seen_tokens.end()) continue;
-          seen_tokens.insert(token_iter->str());
-          int token_idx_end = defmac_as_regex.find(token_iter->str()) + token_iter->str().size();
-          string pre_first_token = defmac_as_regex.substr(0,token_idx_end), 
-                 post_first_token = defmac_as_regex.substr(token_idx_end);
-          backtraced_buffer = pre_first_token + regex_replace(post_first_token, regex(token_iter->str()), to_string(idx));
-        }
-        defmac_as_regex = backtraced_buffer;
-
-        // replace all "$..." with a catch-all regex, EXCEPT for 2 unique cases:
-        //   1) if var token ends the syntax defn, then its regex equivalent only scrapes to last NON-SPACE-CHAR
-        //   2) if var token starts the syntax defn, then its regex equivalent only starts scraping AT a NON-SPACE-CHAR
-        defmac_as_regex = regex_replace(defmac_as_regex, escaped_var_token, R"(((.)+?))");
-        if(defmac_as_regex.rfind(R"(((.)+?))") == defmac_as_regex.size()-7) // var token ends sytax defn
-          defmac_as_regex = defmac_as_regex.replace(defmac_as_regex.size()-7, string::npos, R"(((\S)+))");
-        if(defmac_as_regex.find(R"(((.)+?))") == 0)                         // var token starts sytax defn
-          defmac_as_regex = defmac_as_regex.replace(0, 7, R"(((\S)+))");    // nested parens for idx pattern from \v1, \v2, etc assignment
-        
-        // save regex-variant of syntax defn
-        defmac_macro_regex_map.push_back(DefMacAlias(defmac_as_regex, elt.second));
-        // save prefixed (ie type-distributed) data
+          variable_syntax_index += 2;
+        }
+        elt.second = number_variables(elt.second, program.variable_names());
+
+        // add generated "C++ : program" pair & prefixed (ie type-distributed) data from #defmac "macro"
+        DefmacAlias alias{elt.second, std::move(program), {}};
         for(auto prefix_iter = prefixed_token_range.first; prefix_iter != prefixed_token_range.second; ++prefix_iter)
-          formatted_prefixed_token_data.insert(make_pair(elt.second, prefix_iter->second));
+          alias.prefixes.push_back(prefix_iter->second);
+        parsed.macros.aliases.push_back(std::move(alias));
+        parsed.macros.compile_seconds.push_back(MacroProfile::seconds_since(compile_start));
+      }
+      return parsed;
+    }
+
+
+    // A ".dmac" file read & either found in the macro cache, or its directives
+    // parsed (its "#defmac_include"s are left to "include_macro_sets")
+    struct LoadedDmac {
+      bool             opened = false;
+      std::size_t      size = 0;
+      std::uint64_t    hash = 0;
+      bool             cached = false;
+      MacroSet         cached_set; // (if "cached": the whole set, nested includes too)
+      ParsedDirectives parsed;
+      bool is_open() const {return opened;}
+    };
+
+    LoadedDmac load_dmac(const string &filename) const {
+      using namespace std;
+      LoadedDmac loaded;
+      ifstream read_file(filename.c_str());
+      if(!(loaded.opened = read_file.is_open())) return loaded;
+      string scriptBuffer = {istreambuf_iterator<char>(read_file), istreambuf_iterator<char>{}}; // slurp file
+      loaded.size = scriptBuffer.size(), loaded.hash = content_hash(scriptBuffer);
+      loaded.cached = !macro_cache_dir.empty() && load_macro_cache(loaded.hash, loaded.size, loaded.cached_set);
+      if(!loaded.cached) loaded.parsed = parse_directives(scriptBuffer); // (the rest is never mapped)
+      return loaded;
+    }
+
+
+    // 1 ".dmac" set to register & whether it was compiled just now (else its 
+    // compile time is already profiled)
+    struct IncludedSet {
+      SharedMacroSet set;
+      bool           fresh = false;
+    };
+    using IncludedSets = std::unordered_map<string,SharedMacroSet>; // 1 parse's sets, by canonical path
+
+    // The macro sets of "filenames" (1 buffer's "#defmac_include"s, in order): each
+    // path is read & compiled once per parse (then reused from "included"), &
+    // "chain" holds the paths being compiled (naming 1 again is a cycle). Sets
+    // not yet included are read & compiled concurrently (unless shared w/ other
+    // Scripts, which claim them 1 at a time), & are always merged in order.
+    std::vector<IncludedSet> include_macro_sets(const std::vector<string> &filenames, IncludedSets &included, std::vector<string> &chain) {
+      using namespace std;
+      vector<string> keys;
+      for(auto &filename : filenames) keys.push_back(filename.empty() ? filename : MacroSetStore::key_of(filename));
+      unordered_map<string,LoadedDmac> prefetched;
+      if(!shared_macro_sets) {
+        vector<size_t> loads;
+        for(size_t i = 0; i < keys.size(); ++i)
+          if(!keys[i].empty() && !included.count(keys[i]) && find(chain.begin(), chain.end(), keys[i]) == chain.end() 
+                              && prefetched.emplace(keys[i], LoadedDmac()).second)
+            loads.push_back(i);
+        WorkStealingPool::run(loads.size(), map_threads, [&](size_t i) {prefetched.at(keys[loads[i]]) = load_dmac(filenames[loads[i]]);});
+      }
+      vector<IncludedSet> sets(filenames.size());
+      for(size_t i = 0; i < filenames.size(); ++i) {
+        if(keys[i].empty()) continue;
+        confirmIncludeIsAcyclic(chain, keys[i]);
+        auto known = included.find(keys[i]);
+        if(known != included.end()) {
+          sets[i].set = known->second;
+          continue;
+        }
+        auto loaded = prefetched.find(keys[i]);
+        sets[i] = include_macro_set(filenames[i], keys[i], loaded == prefetched.end() ? nullptr : &loaded->second, included, chain);
+        included[keys[i]] = sets[i].set;
+      }
+      return sets;
+    }
+
+    // "filename"'s whole macro set: its nested includes' sets, then its own #defmac's
+    IncludedSet include_macro_set(const string &filename, const string &key, LoadedDmac *loaded, IncludedSets &included, std::vector<string> &chain) {
+      using namespace std;
+      // another Script sharing this one's macro sets may already have (or be) compiling it
+      promise<SharedMacroSet> compiled_set;
+      if(shared_macro_sets) {
+        shared_future<SharedMacroSet> shared_set;
+        while(!shared_macro_sets->claim(filename, shared_set, compiled_set)) {
+          const SharedMacroSet &macro_set = shared_set.get(); // rethrows the compiling Script's error
+          if(!shared_macro_sets->revalidate || nested_sources_unchanged(*macro_set)) return {macro_set, false};
+          shared_macro_sets->evict(filename, macro_set); // a nested "#defmac_include" changed
+        }
+      }
+
+      // reuse the set compiled from this exact content, else compile & cache it
+      try {
+        LoadedDmac loaded_now;
+        if(!loaded) loaded_now = load_dmac(filename), loaded = &loaded_now;
+        confirmFileIsOpen(*loaded, filename);
+        auto macro_set = make_shared<MacroSet>();
+        if(loaded->cached) {
+          *macro_set = std::move(loaded->cached_set);
+        } else {
+          auto append = [&macro_set](const MacroSet &part, bool fresh) {
+            macro_set->compile_seconds.resize(macro_set->aliases.size()); // (0 if cached or already profiled)
+            macro_set->sources.insert(macro_set->sources.end(), part.sources.begin(), part.sources.end());
+            macro_set->aliases.insert(macro_set->aliases.end(), part.aliases.begin(), part.aliases.end());
+            if(fresh) macro_set->compile_seconds.insert(macro_set->compile_seconds.end(), part.compile_seconds.begin(), part.compile_seconds.end());
+          };
+          macro_set->sources.emplace_back(filename, loaded->hash);
+          chain.push_back(key);
+          for(auto &nested : include_macro_sets(loaded->parsed.include_filenames, included, chain)) append(*nested.set, nested.fresh);
+          chain.pop_back();
+          append(loaded->parsed.macros, true);
+          if(!macro_cache_dir.empty()) save_macro_cache(loaded->hash, loaded->size, *macro_set);
+        }
+        if(shared_macro_sets) compiled_set.set_value(macro_set);
+        return {macro_set, !loaded->cached};
+      } catch(...) { // (only if "throw_on_error") don't leave waiters on, nor keep, a half-built set
+        if(shared_macro_sets) {
+          compiled_set.set_exception(current_exception());
+          shared_macro_sets->evict(filename, nullptr);
+        }
+        throw;
       }
+    }
 
-      // add generated "C++ : regex" pairs from #defmac "macros" to this' "script_syntax" unordered map member
-      for(auto elt : defmac_macro_regex_map) { 
-        script_syntax.push_back(CppAlias(elt.second,regex(elt.first)));
-        if(show_info)
-          cout << endl << elt.first << endl << elt.second << endl;
+
+    // Given std::string buffer: parses out, compiles, and inserts #defmac
+    // "macros" to the "script_syntax" std::vector of std::pair member. 
+    // Returns std::string of accumulated #defmac "macros" rmvd from buffer.
+    // => "#defmac_include"d files' sets go 1st, in order (see "include_macro_sets")
+    string parse_defmac_macros(string &buffer) {
+      ParsedDirectives parsed = parse_directives(buffer);
+      IncludedSets included;
+      std::vector<string> chain;
+      std::unordered_set<string> listed;
+      included_files.clear();
+      for(auto &include : include_macro_sets(parsed.include_filenames, included, chain)) {
+        register_macro_set(*include.set, include.fresh);
+        for(auto &source : include.set->sources)
+          if(listed.insert(MacroSetStore::key_of(source.first)).second) included_files.push_back(source.first);
       }
+      register_macro_set(parsed.macros, true);
+      return parsed.defmac_buffer;
+    }
+
+
+    // Compile "read_filename"'s #defmac's (& "#defmac_include"s) into a C++ header of
+    // constexpr matchers at "write_filename", for programs whose macro set is fixed
+    // at build time: "#include" it after this file (w/ DEFMAC_NO_MAIN defined) &
+    // "push_static_macros(<namespace>::macros)". Returns the # of macros emitted
+    // (0 == none, & nothing written)
+    std::size_t emit_matcher(const string read_filename, const string write_filename) {
+      using namespace std;
+      ifstream read_file(read_filename.c_str());
+      confirmFileIsOpen(read_file, read_filename);
+      string buffer = {istreambuf_iterator<char>(read_file), istreambuf_iterator<char>{}};
+      read_file.close();
+
+      MacroSet emitted;
+      MacroSet *outer_recorder = macro_set_recorder;
+      macro_set_recorder = &emitted;
+      parse_defmac_macros(buffer);
+      macro_set_recorder = outer_recorder;
+      if(emitted.aliases.empty()) return 0;
 
-      return defmac_buffer;
+      // namespace: the input's stem as an identifier (ie "my-macros.dmac" => "my_macros")
+      string name = filesystem::path(read_filename).stem().string();
+      for(auto &c : name) if(!isalnum(static_cast<unsigned char>(c))) c = '_';
+      if(name.empty() || isdigit(static_cast<unsigned char>(name[0]))) name = '_' + name;
+
+      ostringstream write_file; // (built whole, so an unchanged header can be left alone)
+      write_file << "// Generated by \"defmac --emit-matcher\" from \"" << read_filename << "\": do not edit.\n"
+                 << "// #include after defmac.cpp (w/ DEFMAC_NO_MAIN defined), then register w/\n"
+                 << "// yourScript.push_static_macros(" << name << "::macros);\n"
+                 << "#pragma once\n#include <string_view>\n\n"
+                 << "namespace " << name << " {\n";
+      vector<string> initializers;
+      for(size_t i = 0; i < emitted.aliases.size(); ++i) {
+        const DefmacAlias &alias = emitted.aliases[i];
+        const string macro = "macro_" + to_string(i);
+        string syntax = alias.program.syntax_source();
+        for(size_t nl = syntax.find('\n'); nl != string::npos; nl = syntax.find('\n', nl)) syntax.replace(nl, 1, "\\n");
+        write_file << "  // #defmac `" << syntax << "`\n";
+        const string program = alias.program.emit_static(write_file, macro);
+        string prefixes = "nullptr, 0";
+        if(!alias.prefixes.empty()) {
+          write_file << "  inline constexpr DEF_MAC::Script::StaticDefmac::Prefix " << macro << "_prefixes[] = {";
+          for(size_t p = 0; p < alias.prefixes.size(); ++p)
+            write_file << (p ? ", " : "") << '{' << string_view_source(alias.prefixes[p].type) << ", " << string_view_source(alias.prefixes[p].token) << '}';
+          write_file << "};\n";
+          prefixes = macro + "_prefixes, " + to_string(alias.prefixes.size());
+        }
+        initializers.push_back("{" + string_view_source(alias.cpp_key) + ", " + program + ", " + prefixes + "}");
+        write_file << '\n';
+      }
+      write_file << "  inline constexpr DEF_MAC::Script::StaticDefmac macros[] = {\n";
+      for(auto &initializer : initializers) write_file << "    " << initializer << ",\n";
+      write_file << "  };\n} // end of namespace " << name << '\n';
+      write_output(write_filename, write_file.str());
+      write_dependency_file(read_filename, write_filename);
+      return emitted.aliases.size();
     }
 
 
     // Given std::string buffer using the defined custom script syntax, returns ANOTHER buffer
     // (std::string) with the "script_syntax" std::vector of std::pair member's regex 
     // "script-syntax vals" mapped to its "C++ keys"
-    string map_buffer(string buffer) {
-      using namespace std;
+    string map_buffer(string buffer) {return map_framed_buffer(std::move(buffer), false);}
 
-      set<int> var_token_match_idx_set;
-      string replace_key, mapped_cppified_key;
+  private:
+    // "map_buffer", w/ the file prefixes 1st if "prefixed": prefixes, commented
+    // #defmac's, & mapped body are appended once each, to 1 exactly sized string
+    string map_framed_buffer(string buffer, bool prefixed) {
+      using namespace std;
+      FileBudget budget(*this, string());
       const string defmac_buffer = parse_defmac_macros(buffer);
-      const regex var_token_match_reg(R"((\\v[\d]+))");
-      const regex token_bound(R"([_[:alpha:]]\w*)");
-      regex current_var_token_reg, replace_val;
-      smatch matches;
+      if(code_only && show_info) {
+        const CodeMap code_map = CodeMap::lex(buffer);
+        size_t skipped_bytes = 0;
+        for(auto &span : code_map.skipped()) skipped_bytes += span.end - span.begin;
+        cout << endl << "-:- Lexer skips " << skipped_bytes << " of " << buffer.size() 
+             << " bytes (" << code_map.skipped().size() << " comments & literals) -:-" << endl;
+      }
+      const size_t skipped_aliases = apply_aliases(buffer);
+      if(show_info)
+        cout << endl << "-:- Anchor prefilter skipped " << skipped_aliases << " of " 
+             << script_syntax.size() << " aliases -:-" << endl;
+      size_t prefixes_size = 0;
+      if(prefixed) for(auto &prefix : file_prefixes) prefixes_size += prefix.size();
+      string framed;
+      framed.reserve(prefixes_size + defmac_buffer.size() + 6 + buffer.size());
+      if(prefixed) for(auto &prefix : file_prefixes) framed += prefix;
+      return framed.append("/*\n").append(defmac_buffer).append("*/\n").append(buffer); // prefix buffer with commented defmac "macros"
+    }
+
+  public:
+
+
+    // Apply every alias, top-down, to "buffer" (its #defmac's already parsed out).
+    // Returns the # of aliases the anchor prefilter skipped. "tracked" (if given)
+    // follows 1 position through every rewrite, becoming npos if a match straddles it.
+    // => a big buffer whose lines map independently (no match crosses a '\n', so every
+    //    alias applied top-down to each line == to the whole buffer) maps its chunks of
+    //    lines on "map_threads" threads, stitched back in order: same bytes as serially
+    size_t apply_aliases(string &buffer, size_t *tracked = nullptr) {
+      using namespace std;
+      constexpr size_t min_chunk_size = 256 * 1024;
+      const unsigned threads = map_threads ? map_threads : max(1u, thread::hardware_concurrency());
+      if(tracked || show_info || threads == 1 || buffer.size() < 2 * min_chunk_size || !maps_line_local()) {
+        auto scratch = scratch_pool.acquire();
+        const size_t skipped_aliases = apply_aliases_serially(buffer, *scratch, tracked);
+        scratch_pool.release(std::move(scratch));
+        return skipped_aliases;
+      }
+
+      // ~4 chunks per thread (so work-stealing evens out uneven chunks), each ending on a '\n'
+      const size_t chunk_size = max(min_chunk_size, buffer.size() / (4 * size_t(threads)));
+      vector<string> chunks;
+      for(size_t p = 0; p < buffer.size();) {
+        const size_t nl = buffer.find('\n', p + chunk_size);
+        const size_t stop = nl == string::npos ? buffer.size() : nl+1;
+        chunks.push_back(buffer.substr(p, stop - p));
+        p = stop;
+      }
+
+      // workers only read this Script: build its anchors, profile slots, & templates up front
+      refresh_anchors();
+      refresh_profile_slots();
+      for(size_t i = 0; i < script_syntax.size(); ++i)
+        if(script_templates[i].cpp_key != script_syntax[i].first)
+          script_templates[i] = compile_replacement(script_syntax[i].first, script_templates[i].prefixes);
+      vector<size_t> skipped(chunks.size());
+      WorkStealingPool::run(chunks.size(), threads, [&](size_t i) {
+        auto scratch = scratch_pool.acquire();
+        skipped[i] = apply_aliases_serially(chunks[i], *scratch);
+        scratch_pool.release(std::move(scratch));
+      });
+
+      size_t mapped_size = 0;
+      for(auto &chunk : chunks) mapped_size += chunk.size();
+      buffer.clear();
+      buffer.reserve(mapped_size);
+      for(auto &chunk : chunks) buffer += chunk;
+      return *min_element(skipped.begin(), skipped.end()); // (-l maps serially: this only bounds the count)
+    }
+
+  private:
+    size_t apply_aliases_serially(string &buffer, MappingScratch &scratch, size_t *tracked = nullptr) {
+      using namespace std;
+
+      string &mapped_buffer = scratch.mapped_buffer;
+      smatch &matches = scratch.matches;
+      MacroProgram::Match &program_match = scratch.program_match;
+      vector<Edit> &edits = scratch.edits;
+      if(scratch.match_states.size() < script_programs.size()) scratch.match_states.resize(script_programs.size());
+
+      // find every alias anchor's occurrences in 1 pass: aliases w/o any are skipped outright
+      refresh_anchors();
+      refresh_profile_slots();
+      AnchorHits &anchor_hits = scratch.anchor_hits;
+      anchor_hits.resize(script_anchors.size());
+      for(auto &hits : anchor_hits) hits.clear();
+      script_anchors.scan(buffer, 0, buffer.size(), [&](unsigned id, size_t p) {anchor_hits[id].push_back(p);});
+      size_t skipped_aliases = 0;
+
+      // lexer-aware: comments & literals are never matched (re-lexed after each rewrite)
+      CodeMap code_map;
+      if(code_only) code_map = CodeMap::lex(buffer);
 
       // for each C++: Script-CppAlias pair in the regex map
       for(auto phrase = script_syntax.begin(); phrase != script_syntax.end(); ++phrase) { 
-        replace_key = phrase->first;  // C++ to splice in
-        replace_val = phrase->second; // custom script-syntax to splice out
-
-        // mk set of the numbers following any "variable tokens" (ie \\v{\\d}) to know which smatch idx's to retrieve
-        var_token_match_idx_set.clear();
-        sregex_iterator current_var_token_match(replace_key.begin(), replace_key.end(), var_token_match_reg);
-        while(current_var_token_match != sregex_iterator{}) { 
-          var_token_match_idx_set.insert(stoi(current_var_token_match->str().substr(2)));
-          ++current_var_token_match;
+        const MacroProgram &program = script_programs[phrase - script_syntax.begin()];
+        const int anchor = script_anchor_ids[phrase - script_syntax.begin()];
+        if(anchor >= 0 && code_only) { // anchors w/in comments & literals can't start a match
+          auto &hits = anchor_hits[anchor];
+          const size_t anchor_size = script_anchors.anchor(anchor).size();
+          hits.erase(remove_if(hits.begin(), hits.end(), [&](size_t p) {return !code_map.is_code(p, p + anchor_size);}), hits.end());
         }
+        if(anchor >= 0 && anchor_hits[anchor].empty()) {
+          ++skipped_aliases;
+          continue;
+        }
+        ReplacementTemplate &replacement = script_templates[phrase - script_syntax.begin()]; // C++ to splice in
+        if(replacement.cpp_key != phrase->first) replacement = compile_replacement(phrase->first, replacement.prefixes);
+        const regex &replace_val = phrase->second; // custom script-syntax to splice out
+
+        // profiling: search time == the scan's time minus its expansions'
+        MacroProfile::Stats alias_stats;
+        const auto scan_start = profile ? MacroProfile::Clock::now() : MacroProfile::Clock::time_point();
+        const std::uint64_t scan_allocations = thread_allocations();
+        double *distribute_seconds = profile ? &alias_stats.distribute_seconds : nullptr;
+        auto expand = [&](auto &&capture) {
+          if(!profile) return expand_replacement(mapped_buffer, replacement, capture);
+          const auto expand_start = MacroProfile::Clock::now();
+          expand_replacement(mapped_buffer, replacement, capture, distribute_seconds);
+          alias_stats.expand_seconds += MacroProfile::seconds_since(expand_start);
+        };
+        auto record_stats = [&](std::uint64_t attempts) {
+          if(!profile) return;
+          alias_stats.search_seconds = MacroProfile::seconds_since(scan_start) - alias_stats.expand_seconds;
+          alias_stats.attempts = attempts, alias_stats.matches = edits.size(), alias_stats.bytes_scanned = buffer.size();
+          alias_stats.allocations = thread_allocations() - scan_allocations;
+          profile->add(script_profile_slots[phrase - script_syntax.begin()], alias_stats);
+        };
 
-        // map each value (script-syntax skeleton's regex variables) to each 
+        // map each value (script-syntax skeleton's regex variables) to each
         // key (C++ syntax skeleton's respective "variable token" placeholders)
-        while(regex_search(buffer, matches, replace_val)) {
-          mapped_cppified_key = replace_key;                        // get C++ key's syntax map skeleton
-          for(auto var_token_match_idx : var_token_match_idx_set) { // map val vars to key placeholders
-            current_var_token_reg = R"(\\v)" + to_string(var_token_match_idx);
-            // "matches.str(0)" returns entire string that matched, any 
-            // idx > 0 returns var_token_match_idx matching the regex expr
-
-            // check whether ought to distribute types across "matches.str(var_token_match_idx)"
-            const string current_val = R"(\v)" + to_string(var_token_match_idx);
-            string script_syntax_instance = matches.str(var_token_match_idx);
-            string prefixedToken_Data, suffixBuffer;
-
-            auto prefix_range = formatted_prefixed_token_data.equal_range(replace_key);
-            for(auto it = prefix_range.first; it != prefix_range.second; ++it) {
-
-              if(it->second.token == current_val) {
-                smatch token_matches;
-                while(regex_search(script_syntax_instance, token_matches, token_bound)) {
-                  prefixedToken_Data += token_matches.prefix().str() + it->second.type + " " + token_matches.str(0);
-                  script_syntax_instance = suffixBuffer = token_matches.suffix().str();
-                }
-                prefixedToken_Data += suffixBuffer;
-                break;
-              }
+        // => single left-to-right pass: append prefix + expansion to "mapped_buffer"
+        //    & resume searching from the match's end (rather than rebuilding the
+        //    whole buffer & restarting from offset 0 per match)
+        mapped_buffer.clear();
+        edits.clear();
+        auto splice = [&](size_t begin, size_t end, auto &&capture) { // append & record 1 replaced match
+          const size_t new_begin = mapped_buffer.size();
+          expand(capture);
+          edits.push_back(Edit{begin, end, new_begin, mapped_buffer.size() - new_begin});
+        };
+        if(!program.empty()) { // compiled #defmac: \v{2n+1} == capture slot n, \v{2n+2} == its last char
+          MacroProgram::Scanner scanner = anchor >= 0 ? MacroProgram::Scanner(program, buffer, anchor_hits[anchor])
+                                                      : MacroProgram::Scanner(program, buffer);
+          if(code_only) scanner.only_in_code(&code_map);
+          scanner.reuse_state(scratch.match_states[phrase - script_syntax.begin()]);
+          scanner.limit(match_step_budget, mapping_deadline);
+          size_t copied = 0;
+          while(scanner.next(program_match)) {
+            if(edits.empty()) mapped_buffer.reserve(buffer.size());
+            mapped_buffer.append(buffer, copied, program_match.begin - copied);
+            splice(program_match.begin, program_match.end, [&](int idx) {
+              if(idx < 1 || size_t(idx+1)/2 > program.capture_count()) return string_view();
+              string_view capture = program_match.str(buffer, (idx-1)/2);
+              return idx % 2 ? capture : capture.substr(capture.size()-1);
+            });
+            copied = program_match.end;
+          }
+          if(scanner.ran_out_of_time()) confirmWithinTimeBudget(phrase - script_syntax.begin(), buffer, scanner.cut_short_at(), true);
+          if(scanner.budget_hit_count()) report_budget_hits(phrase - script_syntax.begin(), buffer, scanner.budget_hit_count(), scanner.cut_short_at());
+          record_stats(scanner.attempt_count());
+          if(edits.empty()) continue; // no matches: buffer unchanged
+          mapped_buffer.append(buffer, copied, string::npos);
+        } else {
+          auto search_start = buffer.cbegin(), copied = buffer.cbegin();
+          auto search_flags = regex_constants::match_default;
+          std::uint64_t searches = 0;
+          while(++searches, confirmWithinTimeBudget(phrase - script_syntax.begin(), buffer, search_start - buffer.cbegin()),
+                regex_search(search_start, buffer.cend(), matches, replace_val, search_flags)) {
+            const size_t begin = matches[0].first - buffer.cbegin(), end = matches[0].second - buffer.cbegin();
+            search_flags = regex_constants::match_prev_avail; // keep \b & ^ aware of the text behind us
+            if(code_only && !code_map.is_code(begin, begin)) {  // starts w/in a comment/literal: resume past it
+              search_start = buffer.cbegin() + code_map.code_from(begin);
+              continue;
             }
-            if(!prefixedToken_Data.empty()) script_syntax_instance = prefixedToken_Data;
-
-            mapped_cppified_key = regex_replace(mapped_cppified_key, current_var_token_reg, script_syntax_instance);
+            if(edits.empty()) mapped_buffer.reserve(buffer.size());
+            mapped_buffer.append(copied, matches[0].first);
+            splice(begin, end, [&](int idx) {
+              if(size_t(idx) >= matches.size() || !matches[idx].matched) return string_view();
+              return string_view(buffer.data() + (matches[idx].first - buffer.cbegin()), matches[idx].length());
+            });
+            copied = search_start = matches[0].second;
+            if(begin == end) {                                  // step past empty matches (hand-written regex)
+              if(search_start == buffer.cend()) break;
+              ++search_start;
+            }
+          }
+          record_stats(searches);
+          if(edits.empty()) continue; // no matches: buffer unchanged
+          mapped_buffer.append(copied, buffer.cend());
+        }
+        buffer.swap(mapped_buffer);
+        update_anchor_hits(scratch, buffer);
+        if(code_only) code_map = CodeMap::lex(buffer);
+        if(tracked && *tracked != string::npos) {
+          size_t shift = *tracked;
+          for(auto &e : edits) {
+            if(e.old_end > *tracked) {
+              if(e.old_begin < *tracked) shift = string::npos; // match straddles it
+              break;
+            }
+            shift = e.new_begin + e.new_size + (*tracked - e.old_end);
           }
-          buffer = matches.prefix().str() + mapped_cppified_key + matches.suffix().str();
+          *tracked = shift;
         }
       }
-      return "/*\n" + defmac_buffer + "*/\n" + buffer; // prefix buffer with commented defmac "macros"
+      return skipped_aliases;
     }
 
-
-    // Consolidate headers ("#include"s) to the front of the buffer
-    string cluster_buffer_headers(string buffer) {
+    // "cluster_buffer_headers", also trimming runs of > 2 '\n' down to 2 as it 
+    // copies if "trim_newlines" (ie for "map_source": saves it another pass)
+    string cluster_headers(const string &buffer, bool trim_newlines) {
       using namespace std;
-      const regex system_header_pattern(R"(([:blank:]*)#([:blank:]*)include(\s*)<([_[:alpha:]]\w*(\.[_[:alpha:]]\w*)?)>([:blank:]*))");
-      const regex local_header_pattern(R"(([:blank:]*)#([:blank:]*)include(\s*)\"([_[:alpha:]]\w*(\.[_[:alpha:]]\w*)?)\"([:blank:]*))");
-      vector<string> header_vector;
-      
-      for(sregex_iterator it(buffer.begin(), buffer.end(), system_header_pattern); it != sregex_iterator{}; ++it)
-        header_vector.push_back(it->str());
-      for(sregex_iterator it(buffer.begin(), buffer.end(), local_header_pattern);  it != sregex_iterator{}; ++it)
-        header_vector.push_back(it->str());
-      
-      buffer = regex_replace(buffer, system_header_pattern, ""); // rmv system headers
-      buffer = regex_replace(buffer, local_header_pattern,  ""); // rmv local directory headers
-      for(auto &e : header_vector) e += '\n';                    // 1 header per line
-
-      unordered_set<string> header_set;                          // rmv duplicate headers w/o changing #include order
-      for(auto e : header_vector) header_set.insert(e);
-      return merge_container_strings(header_set) + buffer;
+      auto append = [&](string &out, string_view text, unsigned &newlines) {
+        if(trim_newlines) append_trimming_newlines(out, text, newlines);
+        else              out.append(text);
+      };
+      auto is_blank = [](char c) {return c == ' ' || c == '\t';};
+      auto is_space = [](char c) {return c == ' ' || (c >= '\t' && c <= '\r');};
+      auto is_alpha = [](char c) {return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';};
+      auto is_word  = [&](char c) {return is_alpha(c) || (c >= '0' && c <= '9');};
+
+      // end of `#include <name(.ext)>` or `#include "name(.ext)"` at "buffer"[p] (else npos)
+      auto header_end = [&](size_t p) {
+        const size_t n = buffer.size();
+        for(++p; p < n && is_blank(buffer[p]); ++p);
+        if(buffer.compare(p, 7, "include")) return string::npos;
+        for(p += 7; p < n && is_space(buffer[p]); ++p);
+        if(p == n || (buffer[p] != '<' && buffer[p] != '"')) return string::npos;
+        const char close = buffer[p] == '<' ? '>' : '"';
+        for(int part = 0; part < 2; ++part) { // name, then an optional ".ext"
+          if(part && (p+1 >= n || buffer[p+1] != '.')) break;
+          if(part) ++p;
+          if(++p == n || !is_alpha(buffer[p])) return string::npos;
+          while(p+1 < n && is_word(buffer[p+1])) ++p;
+        }
+        return p+1 < n && buffer[p+1] == close ? p+2 : string::npos;
+      };
+
+      vector<string_view> system_headers, local_headers;
+      unordered_set<string_view> seen_headers;
+      string body;
+      body.reserve(buffer.size());
+      unsigned newlines = 0;
+      for(size_t p = 0; p < buffer.size();) {
+        const size_t hash = min(buffer.find('#', p), buffer.size());
+        append(body, string_view(buffer).substr(p, hash - p), newlines);
+        if(hash == buffer.size()) break;
+        const size_t end = header_end(hash);
+        if(end == string::npos) {
+          body += '#', newlines = 0, p = hash+1;
+          continue;
+        }
+        const string_view header(buffer.data() + hash, end - hash);
+        if(seen_headers.insert(header).second)
+          (header.back() == '>' ? system_headers : local_headers).push_back(header);
+        while(!body.empty() && is_blank(body.back())) body.pop_back(); // rmv blanks before & after it
+        for(p = end; p < buffer.size() && is_blank(buffer[p]); ++p);
+        newlines = 0;
+        for(auto c = body.rbegin(); c != body.rend() && *c == '\n'; ++c) ++newlines;
+      }
+
+      // 1 header per line, then the body (whose leading '\n's may now join a run)
+      string clustered;
+      unsigned run = 0;
+      for(auto headers : {&system_headers, &local_headers})
+        for(auto header : *headers) {
+          append(clustered, header, run);
+          append(clustered, "\n", run);
+        }
+      const size_t leading_newlines = min(body.find_first_not_of('\n'), body.size());
+      clustered.reserve(clustered.size() + body.size());
+      append(clustered, string_view(body).substr(0, leading_newlines), run);
+      clustered.append(body, leading_newlines, string::npos);
+      return clustered;
     }
+
+  public:
+    // Consolidate headers ("#include"s) to the front of the buffer: system headers above
+    // locals, each once in the order 1st seen. 1 pass strips them (& the blanks around
+    // them) as it copies the rest
+    string cluster_buffer_headers(const string &buffer) {return cluster_headers(buffer, false);}
   }; // end of class Script
 };   // end of namespace DEF_MAC
 
+
+/******************************************************************************
+* SERVE MODE: RESIDENT MACRO SETS ANSWERING "MAP THIS BUFFER" OVER A SOCKET
+******************************************************************************/
+
+// Protocol (Unix domain stream socket): each message is a uint64 byte count
+// followed by that many bytes, read via ByteReader:
+//   => request  == "protocol" string, client's working directory, filename,
+//                  uint8 options (bit 0: "code_only"), uint64 "match_step_budget",
+//                  double "file_time_budget", buffer
+//   => response == uint8 ok, then the mapped buffer (ok) OR the error message,
+//                  then any skipped match attempts' reports (for the client's cerr)
+// 1 connection may carry any # of requests (ie a whole client batch)
+// => a message over "max_message_size" drops its connection, as does a client
+//    stalling mid-request (or not reading) for "serve_timeout_seconds"
+namespace DEF_MAC {
+  const char serve_protocol[] = "DMACS\x02";
+  constexpr std::uint64_t max_message_size = std::uint64_t(1) << 30;
+  constexpr long serve_timeout_seconds = 10;
+
+  // $DEFMAC_SOCKET, else $XDG_RUNTIME_DIR/defmac.sock, else /tmp/defmac-<user>.sock
+  std::string default_socket_path() {
+    if(const char *path = std::getenv("DEFMAC_SOCKET"))   return path;
+    if(const char *dir  = std::getenv("XDG_RUNTIME_DIR")) return std::string(dir) + "/defmac.sock";
+    if(const char *user = std::getenv("USER"))            return std::string("/tmp/defmac-") + user + ".sock";
+    return "/tmp/defmac.sock";
+  }
+
+#ifdef DEFMAC_POSIX
+  bool send_message(int fd, const std::string &message) {
+    ByteWriter frame;
+    frame.put(std::uint64_t(message.size()));
+    frame.bytes += message;
+    for(std::size_t sent = 0; sent < frame.bytes.size();) {
+      const auto n = ::write(fd, frame.bytes.data() + sent, frame.bytes.size() - sent);
+      if(n <= 0) return false;
+      sent += std::size_t(n);
+    }
+    return true;
+  }
+
+  bool receive_message(int fd, std::string &message) {
+    auto read_all = [fd](char *data, std::size_t size) {
+      for(std::size_t got = 0; got < size;) {
+        const auto n = ::read(fd, data + got, size - got);
+        if(n <= 0) return false;
+        got += std::size_t(n);
+      }
+      return true;
+    };
+    std::uint64_t size = 0;
+    if(!read_all(reinterpret_cast<char *>(&size), sizeof(size)) || size > max_message_size) return false;
+    message.resize(std::size_t(size));
+    return read_all(&message[0], message.size());
+  }
+
+  // -1 if "socket_path" can't be bound/connected (ie no daemon is listening)
+  int open_socket(const std::string &socket_path, bool listening) {
+    sockaddr_un address{};
+    if(socket_path.size() >= sizeof(address.sun_path)) return -1;
+    address.sun_family = AF_UNIX;
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) return -1;
+    const auto addr = reinterpret_cast<const sockaddr *>(&address);
+    if(listening ? ::bind(fd, addr, sizeof(address)) || ::listen(fd, 64) : ::connect(fd, addr, sizeof(address))) {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+#endif
+
+  // Serve "base"'s aliases & prefixes forever: every "#defmac_include"d set
+  // stays compiled (recompiled once edited), so a request only pays for matching.
+  // Requests are mapped 1 at a time, each from its client's working directory.
+  [[noreturn]] void serve(Script base, const std::string &socket_path) {
+#ifdef DEFMAC_POSIX
+    std::signal(SIGPIPE, SIG_IGN);
+    base.share_macro_sets(true);
+    base.throw_on_error = true;
+    const int probe = open_socket(socket_path, false);
+    if(probe >= 0) {
+      ::close(probe);
+      std::cerr << "-:- a defmac server already listens on \"" << socket_path << "\" -:-\n";
+      std::exit(EXIT_FAILURE);
+    }
+    struct stat stale;
+    if(::lstat(socket_path.c_str(), &stale) == 0) { // a dead server's socket: never unlink anything else
+      if(!S_ISSOCK(stale.st_mode)) {
+        std::cerr << "-:- \"" << socket_path << "\" exists & isn't a socket: not serving on it -:-\n";
+        std::exit(EXIT_FAILURE);
+      }
+      ::unlink(socket_path.c_str());
+    }
+    const int server = open_socket(socket_path, true);
+    if(server < 0) {
+      std::cerr << "-:- couldn't listen on \"" << socket_path << "\" -:-\n";
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "\033[1m -:- defmac serving on " << socket_path << " -:-\033[0m" << std::endl;
+
+    for(;;) {
+      const int client = ::accept(server, nullptr, nullptr);
+      if(client < 0) continue;
+      const timeval timeout{serve_timeout_seconds, 0}; // (1 client at a time: a stalled 1 mustn't block the rest)
+      ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      for(std::string request;;) {
+        try {
+          if(!receive_message(client, request)) break;
+        } catch(const std::exception &) { // (ie bad_alloc: drop the client, not the daemon)
+          break;
+        }
+        ByteReader in{request};
+        std::string filename;
+        std::ostringstream reports;
+        ByteWriter out;
+        try {
+          const std::string protocol = in.get_str(), directory = in.get_str();
+          filename = in.get_str();
+          const std::uint8_t flags = in.get<std::uint8_t>();
+          const std::uint64_t step_budget = in.get<std::uint64_t>();
+          const double time_budget = in.get<double>();
+          const std::string buffer = in.get_str();
+          if(!in.ok || protocol != serve_protocol) 
+            throw std::runtime_error("malformed request (client & server versions differ?)");
+          std::error_code ec;
+          std::filesystem::current_path(directory, ec);
+          if(ec) throw std::runtime_error("couldn't enter directory \"" + directory + "\"!");
+          Script request_script(base); // shares (& adds to) base's compiled macro sets
+          request_script.code_only = flags & 1;
+          request_script.match_step_budget = step_budget;
+          request_script.file_time_budget = time_budget;
+          request_script.budget_reports = &reports;
+          const std::string mapped = request_script.map_source(buffer);
+          out.put(std::uint8_t(1)), out.put_str(mapped);
+        } catch(const std::exception &e) {
+          out = ByteWriter();
+          out.put(std::uint8_t(0)), out.put_str(filename + ": " + e.what());
+        }
+        out.put_str(reports.str());
+        if(!send_message(client, out.bytes)) break;
+      }
+      ::close(client);
+    }
+#else
+    (void)base;
+    std::cerr << "-:- \"--serve\" needs Unix domain sockets (unsupported on this platform): \"" << socket_path << "\" -:-\n";
+    std::exit(EXIT_FAILURE);
+#endif
+  }
+
+  // 1 client connection to a "serve"ing daemon
+  class ServeClient {
+    int fd = -1;
+  public:
+    explicit ServeClient(const std::string &socket_path) {
+#ifdef DEFMAC_POSIX
+      std::signal(SIGPIPE, SIG_IGN);
+      fd = open_socket(socket_path, false);
+#else
+      (void)socket_path;
+#endif
+    }
+    ServeClient(const ServeClient &) = delete;
+    ServeClient &operator=(const ServeClient &) = delete;
+    ~ServeClient() {
+#ifdef DEFMAC_POSIX
+      if(fd >= 0) ::close(fd);
+#endif
+    }
+    bool connected() const {return fd >= 0;}
+
+    // Map "filename"'s contents "buffer" on the daemon w/ "settings"' "code_only" &
+    // budgets: false (w/ "error") if it reports an error or the connection breaks 
+    // (then "connected()" == false). Skipped match attempts go to "settings.budget_reports"
+    bool map(const std::string &filename, const std::string &buffer, const Script &settings, std::string &mapped, std::string &error) {
+#ifdef DEFMAC_POSIX
+      std::error_code ec;
+      ByteWriter request;
+      request.put_str(serve_protocol);
+      request.put_str(std::filesystem::current_path(ec).string());
+      request.put_str(filename);
+      request.put(std::uint8_t(settings.code_only));
+      request.put(settings.match_step_budget);
+      request.put(settings.file_time_budget);
+      request.put_str(buffer);
+      std::string response;
+      if(fd >= 0 && send_message(fd, request.bytes) && receive_message(fd, response)) {
+        ByteReader in{response};
+        const bool ok = in.get<std::uint8_t>() == 1;
+        (ok ? mapped : error) = in.get_str();
+        const std::string reports = in.get_str();
+        if(in.ok) return *settings.budget_reports << reports, ok;
+      }
+      if(fd >= 0) ::close(fd), fd = -1;
+      error = "lost connection to the defmac server";
+#else
+      (void)filename, (void)buffer, (void)settings, (void)mapped;
+      error = "no defmac server";
+#endif
+      return false;
+    }
+  };
+};   // end of namespace DEF_MAC
+
+/******************************************************************************
+* WATCH MODE: RE-MAPPING A FILE ON EVERY SAVE, INCREMENTALLY
+******************************************************************************/
+
+namespace DEF_MAC {
+  // Map "read_filename" to "write_filename", then re-map it whenever it (or a
+  // "#defmac_include"d file it names) changes, polling every "interval": edits 
+  // only re-map the lines they touch (see Script::remap_file). Errors (ie a 
+  // half-saved "#defmac_include") are reported & the file is retried once it changes.
+  [[noreturn]] void watch(Script base, const std::string &read_filename, const std::string &write_filename,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds(100)) {
+    using Stamp = std::pair<std::filesystem::file_time_type,std::uintmax_t>;
+    base.share_macro_sets(true); // unchanged "#defmac_include"s stay compiled
+    base.throw_on_error = true;
+    Script::IncrementalState state;
+    state.sources.assign(1, read_filename);
+    auto stamp_sources = [&state] {
+      std::vector<Stamp> stamps;
+      for(auto &source : state.sources) {
+        std::error_code ec;
+        stamps.emplace_back(std::filesystem::last_write_time(source, ec), std::filesystem::file_size(source, ec));
+      }
+      return stamps;
+    };
+    std::vector<Stamp> stamps;
+    std::cout << "\033[1m -:- defmac watching " << read_filename << " (Ctrl-C to stop) -:-\033[0m" << std::endl;
+
+    for(;;) {
+      if(stamp_sources() != stamps) {
+        const std::vector<std::string> sources = state.sources;
+        stamps = stamp_sources();
+        try {
+          Script script(base); // fresh aliases: "remap_file" compares them w/ the last mapping's
+          const auto start = std::chrono::steady_clock::now();
+          const std::size_t remapped = script.remap_file(read_filename, write_filename, state);
+          const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+          std::cout << "\033[1m -:- " << read_filename << " ==PARSED=MAPPED=> " << write_filename << " (" << remapped 
+                    << " of " << state.body.size() << " bytes re-mapped, " << ms << "ms) -:-\033[0m" << std::endl;
+        } catch(const std::exception &e) {
+          std::cerr << "\033[1m\033[31m -:- " << read_filename << ": " << e.what() << " -:-\033[0m" << std::endl;
+          state.valid = false;
+        }
+        if(state.sources != sources) stamps = stamp_sources(); // (newly named "#defmac_include"s)
+      }
+      std::this_thread::sleep_for(interval);
+    }
+  }
+};   // end of namespace DEF_MAC
+
 /******************************************************************************
 * FILE ERROR HANDLING FUNCTION
 ******************************************************************************/
 
+// Cmd-Line Settings Parsed From argv
+struct CmdLineOptions {
+  bool        show_info = false;
+  bool        cache_macros = false;
+  bool        code_only = false;
+  bool        stream = false;   // map in bounded memory via "stream_file"
+  bool        profile = false;  // print per-alias costs once mapped
+  std::string profile_json;     // (or write them to this file as JSON)
+  std::size_t max_match_span = 0; // (0 == Script's default)
+  bool        serve = false;  // run as a daemon on DEF_MAC::default_socket_path()
+  bool        client = false; // map via that daemon
+  bool        watch = false;  // re-map the file whenever it changes
+  bool        emit_matcher = false; // write the file's #defmac's as constexpr matchers
+  bool        write_if_changed = false;   // leave outputs (& mtimes) alone if their bytes'd match
+  bool        write_dependencies = false; // write a make rule per output ("<output>.d")
+  std::string dependency_filename;        // (or, for 1 file, to this file instead)
+  std::uint64_t max_steps = 0;   // backtracking steps per match attempt (0 == no cap)
+  double        max_seconds = 0; // seconds per file's mapping (0 == no cap)
+  unsigned    jobs = 0; // batch worker threads, or 1 big file's (0 == all cores)
+  std::string parse_filename, write_filename;
+  // batch mode: (read, write) filename pairs, in cmd-line order
+  std::vector<std::pair<std::string,std::string>> batch;
+};
+
+// Print a cmd-line error & exit
+[[noreturn]] void cmd_line_error(const char *func, int line, const std::string &message) {
+  std::cerr << "\033[1m" << __FILE__ << ":" << func << ":" << line 
+   << ":\033[31m ERROR:\033[0m\033[1m " << message << "\033[0m\n"
+   << "-:- Terminating Program -:-\n";
+  std::exit(EXIT_FAILURE);
+}
+
+// Expand 1 batch input into "files": "@list" == 1 input per line (blank & '#' 
+// lines skipped), a directory == its C/C++ sources (recursively, minus generated 
+// "_DMAC.cpp" files) paired w/ their path relative to it
+void expand_batch_input(const std::string &input, std::vector<std::pair<std::string,std::string>> &files) {
+  namespace fs = std::filesystem;
+  static const std::unordered_set<std::string> sources = {".c",".cc",".cpp",".cxx",".h",".hh",".hpp",".hxx"};
+  constexpr auto ends_with = [](const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size()-suffix.size(), suffix.size(), suffix) == 0;
+  };
+  if(input.size() > 1 && input[0] == '@') {
+    std::ifstream list(input.substr(1));
+    if(!list.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open response file \"" + input.substr(1) + "\"!");
+    for(std::string line; std::getline(list, line);) {
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if(!line.empty() && line[0] != '#') expand_batch_input(line, files);
+    }
+  } else if(fs::is_directory(input)) {
+    std::vector<std::pair<std::string,std::string>> found;
+    for(auto &entry : fs::recursive_directory_iterator(input))
+      if(entry.is_regular_file() && sources.count(entry.path().extension().string()) && !ends_with(entry.path().string(), "_DMAC.cpp"))
+        found.emplace_back(entry.path().string(), fs::relative(entry.path(), input).string());
+    std::sort(found.begin(), found.end()); // directory order is unspecified
+    files.insert(files.end(), found.begin(), found.end());
+  } else if(fs::is_regular_file(input)) {
+    files.emplace_back(input, fs::path(input).filename().string());
+  } else {
+    cmd_line_error(__func__, __LINE__, "couldn't open file \"" + input + "\"!");
+  }
+}
+
 // Parses Cmd-Line argv Input:
 // CMD LINE FLAGS:
 //   1) -l == show info (print defmac.cpp's interpretation of #defmac macros)
 //   2) -local == local edit, no new file generated 
 //      (typically generates new name via oldFileName+"_DMAC.cpp")
 //   3) -o == the following string is the name of the generated file (like GCC)
-void confirm_valid_cmd_line_input(int argc, char **argv, bool &show_info, 
-std::string &parse_filename, std::string &write_filename) {
+//      (the directory to write generated files into, in batch mode)
+//   4) -cache == cache compiled "#defmac_include" files (in $DEFMAC_CACHE_DIR
+//      or $XDG_CACHE_HOME/defmac or $HOME/.cache/defmac)
+//   5) -j == the following number is the # of worker threads (mapping a batch's
+//      files, or else 1 big file's chunks of lines)
+//   6) -lex == lexer-aware matching: comments & string/char literals are left as-is
+//   7) -stream == map in bounded memory; "-span" == the following number is the 
+//      longest match (in bytes) of any alias able to match across lines
+//   8) --serve == run as a daemon on $DEFMAC_SOCKET (see DEF_MAC::serve)
+//   9) --client == map via that daemon, w/ the same flags & inputs
+//  10) -prof == print each alias's costs once mapped; "-prof-json" == the 
+//      following string is a file to write them to as JSON instead
+//  11) --watch == re-map 1 file each time it's saved (see DEF_MAC::watch)
+//  12) --emit-matcher == write 1 file's compiled #defmac's as a C++ header of
+//      constexpr matchers (see DEF_MAC::Script::emit_matcher), "_DMAC.hpp" by default
+//  13) -if-changed == only write outputs whose bytes would change (keeping the 
+//      others' mtimes, so make/ninja rebuild nothing downstream of them)
+//  14) -MD == also write each output's make dependencies (its input & every file 
+//      "#defmac_include"d) to the output's name w/ a ".d" extension; "-MF" == the
+//      following string is 1 file's dependency file's name instead (implies -MD)
+//  15) -max-steps == the following number caps each match attempt's backtracking
+//      steps (attempts over it are skipped & reported); "-max-seconds" == the
+//      following number caps each file's mapping time (running over it is an error)
+// >1 input, an "@response_file", or a directory maps a whole batch of files
+void confirm_valid_cmd_line_input(int argc, char **argv, CmdLineOptions &options) {
   constexpr auto generate_filename = [](const std::string &readFile, const std::string &extension){
     return readFile.substr(0, readFile.rfind(".")) + extension;
   };
-  bool no_default_writeFile = false;
+  bool no_default_writeFile = false, local_edit = false;
+  std::vector<std::string> inputs;
 
-  if(argc > 4 || argc < 2) {
+  if(argc < 2) {
     std::cerr << "\n\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
-     << ":\n\033[31m ERROR:\033[0m\033[1m > 3 OR < 1 cmd-line args recieved!\033[0m\n"
+     << ":\n\033[31m ERROR:\033[0m\033[1m < 1 cmd-line args recieved!\033[0m\n"
      << "Cmd-Line Args MAY Include:\n"
      << "    \"-l\":     show parser's regex interpretation of \"#defmac\" macros\n"
-     << "    \"-local\": edit native file, do \033[1mNOT\033[0m generate a new file\n"
+     << "    \"-local\": edit native file(s), do \033[1mNOT\033[0m generate a new file\n"
      << "    \"-o\":     following string becomes the generated file's name\n"
+     << "              (or the generated files' directory in batch mode)\n"
+     << "    \"-cache\": reuse compiled \"#defmac_include\" files across runs\n"
+     << "    \"-j\":     following number of worker threads (batch files or 1 big file's lines)\n"
+     << "    \"-lex\":   never match w/in comments or string/char literals\n"
+     << "    \"-stream\": map in bounded memory (\"-span N\": longest multi-line match)\n"
+     << "    \"-prof\":  report each macro's costs (\"-prof-json\" + filename: as JSON)\n"
+     << "    \"--serve\": run as a daemon keeping \"#defmac_include\"s compiled ($DEFMAC_SOCKET)\n"
+     << "    \"--client\": map via that daemon (locally if it isn't running)\n"
+     << "    \"--watch\": re-map the file on every save (only the lines edited)\n"
+     << "    \"--emit-matcher\": write the file's #defmac's as a header of constexpr matchers\n"
+     << "    \"-if-changed\": leave outputs whose bytes wouldn't change untouched (& their mtimes)\n"
+     << "    \"-MD\":    also write each output's make dependencies to \"<output>.d\"\n"
+     << "              (\"-MF\" + filename: to that file instead)\n"
+     << "    \"-max-steps\": following number caps each match attempt's steps (over it: skipped)\n"
+     << "    \"-max-seconds\": following number caps each file's mapping time (over it: an error)\n"
      << "Cmd-Line Args MUST Include:\n"
      << "    \"yourFilename.cpp\": file to parse/apply \"#defmac\"-macros/syntax-mapping\n"
+     << "    \033[1mOR\033[0m >1 files, directories, &/or \"@fileList\"s to map as a batch\n"
      << "-:- Terminating Program -:-\n\n";
     std::exit(EXIT_FAILURE);
   }
 
   for(int i = 1; i < argc; ++i) {
     if(std::string(argv[i]) == "-l")
-      show_info = true;            // show info
+      options.show_info = true;    // show info
     else if(std::string(argv[i]) == "-local")
-      no_default_writeFile = true; // edit local file
+      no_default_writeFile = local_edit = true; // edit local file
+    else if(std::string(argv[i]) == "-cache")
+      options.cache_macros = true; // cache compiled macro sets
+    else if(std::string(argv[i]) == "-lex")
+      options.code_only = true;    // lexer-aware matching
+    else if(std::string(argv[i]) == "-stream")
+      options.stream = true;       // bounded-memory mapping
+    else if(std::string(argv[i]) == "-prof")
+      options.profile = true;      // per-alias cost report
+    else if(std::string(argv[i]) == "-prof-json") {
+      if(i == argc-1) cmd_line_error(__func__, __LINE__, "No JSON Profile Filename Passed After '-prof-json'!");
+      options.profile = true, options.profile_json = std::string(argv[i+1]), ++i;
+    }
+    else if(std::string(argv[i]) == "-max-steps") {
+      if(i == argc-1 || std::string(argv[i+1]).find_first_not_of("0123456789") != std::string::npos)
+        cmd_line_error(__func__, __LINE__, "No Step Budget Passed After '-max-steps'!");
+      options.max_steps = std::stoull(argv[i+1]), ++i;
+    } else if(std::string(argv[i]) == "-max-seconds") {
+      if(i == argc-1 || std::string(argv[i+1]).find_first_not_of("0123456789.") != std::string::npos || !std::atof(argv[i+1]))
+        cmd_line_error(__func__, __LINE__, "No Time Budget Passed After '-max-seconds'!");
+      options.max_seconds = std::atof(argv[i+1]), ++i;
+    } else if(std::string(argv[i]) == "-span") {
+      if(i == argc-1 || std::string(argv[i+1]).find_first_not_of("0123456789") != std::string::npos)
+        cmd_line_error(__func__, __LINE__, "No Max Match Span Passed After '-span'!");
+      options.max_match_span = std::stoul(argv[i+1]), ++i;
+    } else if(std::string(argv[i]) == "--serve")
+      options.serve = true;        // run as a daemon
+    else if(std::string(argv[i]) == "--client")
+      options.client = true;       // map via the daemon
+    else if(std::string(argv[i]) == "--watch")
+      options.watch = true;        // re-map on every save
+    else if(std::string(argv[i]) == "--emit-matcher")
+      options.emit_matcher = true; // write a constexpr matcher header
+    else if(std::string(argv[i]) == "-if-changed")
+      options.write_if_changed = true;   // skip unchanged outputs
+    else if(std::string(argv[i]) == "-MD")
+      options.write_dependencies = true; // write make dependencies
+    else if(std::string(argv[i]) == "-MF") {
+      if(i == argc-1) cmd_line_error(__func__, __LINE__, "No Dependency Filename Passed After '-MF'!");
+      options.write_dependencies = true, options.dependency_filename = std::string(argv[i+1]), ++i;
+    }
     else if(std::string(argv[i]) == "-o") {
       no_default_writeFile = true; // custom write file name
-      if(i == argc-1) {
-        std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
-         << ":\033[31m ERROR:\033[0m\033[1m No Custom \"Write\" Filename Passed After '-o'!\033[0m\n"
-         << "-:- Terminating Program -:-\n";
-        std::exit(EXIT_FAILURE);
-      }
-      write_filename = std::string(argv[i+1]), ++i;
+      if(i == argc-1) cmd_line_error(__func__, __LINE__, "No Custom \"Write\" Filename Passed After '-o'!");
+      options.write_filename = std::string(argv[i+1]), ++i;
+    } else if(std::string(argv[i]) == "-j") {
+      if(i == argc-1 || std::string(argv[i+1]).find_first_not_of("0123456789") != std::string::npos)
+        cmd_line_error(__func__, __LINE__, "No Worker Thread Count Passed After '-j'!");
+      options.jobs = unsigned(std::stoul(argv[i+1])), ++i;
     } else
-      parse_filename = argv[i];
+      inputs.push_back(argv[i]);
   }
 
-  if(parse_filename.empty()) {
-    std::cerr << "\033[1m" << __FILE__ << ":" << __func__ << ":" << __LINE__ 
-     << ":\033[31m ERROR:\033[0m\033[1m Cmd-Line Args Missing A Parseable C++ File!\033[0m\n"
-     << "-:- Terminating Program -:-\n";
-    std::exit(EXIT_FAILURE);
+  if(options.serve) {
+    if(!inputs.empty()) cmd_line_error(__func__, __LINE__, "'--serve' Takes No Files (Clients Send Them)!");
+    return;
+  }
+  if(inputs.empty()) cmd_line_error(__func__, __LINE__, "Cmd-Line Args Missing A Parseable C++ File!");
+  if(options.watch && options.write_dependencies) // (the rule'd go stale on the 1st save)
+    cmd_line_error(__func__, __LINE__, "'--watch' Can't Write Dependencies!");
+
+  // 1 plain file: map it alone
+  if(inputs.size() == 1 && inputs[0][0] != '@' && !std::filesystem::is_directory(inputs[0])) {
+    options.parse_filename = inputs[0];
+    if(!no_default_writeFile)
+      options.write_filename = generate_filename(options.parse_filename, options.emit_matcher ? "_DMAC.hpp" : "_DMAC.cpp");
+    if(options.watch && local_edit) // (each re-map would be re-mapped in turn)
+      cmd_line_error(__func__, __LINE__, "'--watch' Can't Edit Its File Locally!");
+    if(options.emit_matcher && local_edit)
+      cmd_line_error(__func__, __LINE__, "'--emit-matcher' Can't Edit Its File Locally!");
+    return;
   }
+  if(options.watch) cmd_line_error(__func__, __LINE__, "'--watch' Takes 1 File!");
+  if(options.emit_matcher) cmd_line_error(__func__, __LINE__, "'--emit-matcher' Takes 1 File!");
+  if(!options.dependency_filename.empty()) cmd_line_error(__func__, __LINE__, "'-MF' Takes 1 File (Use '-MD' For Batches)!");
 
-  if(!no_default_writeFile)
-    write_filename = generate_filename(parse_filename, "_DMAC.cpp");
+  // batch: keep "_DMAC.cpp" naming, mirroring inputs' relative paths under any '-o' directory
+  std::vector<std::pair<std::string,std::string>> files;
+  for(auto &input : inputs) expand_batch_input(input, files);
+  if(files.empty()) cmd_line_error(__func__, __LINE__, "Cmd-Line Batch Has No Parseable C++ Files!");
+  for(auto &file : files) {
+    if(local_edit)
+      options.batch.emplace_back(file.first, file.first);
+    else if(!options.write_filename.empty())
+      options.batch.emplace_back(file.first, (std::filesystem::path(options.write_filename) / generate_filename(file.second, "_DMAC.cpp")).string());
+    else
+      options.batch.emplace_back(file.first, generate_filename(file.first, "_DMAC.cpp"));
+  }
+}
+
+// Map each (read, write) file pair via a "--serve"ing daemon, mapping them w/ 
+// "script" locally instead if none answers (or the connection drops), & note
+// each file's round trip in "file_seconds" (if it's sized to "files")
+void map_files_via_server(const DEF_MAC::Script &script, const std::vector<std::pair<std::string,std::string>> &files,
+                          std::vector<double> &file_seconds) {
+  DEF_MAC::ServeClient client(DEF_MAC::default_socket_path());
+  for(std::size_t i = 0; i < files.size(); ++i) {
+    const auto &file = files[i];
+    const auto start = DEF_MAC::MacroProfile::Clock::now();
+    std::string mapped, error;
+    bool served = false;
+    if(client.connected()) {
+      std::ifstream read_file(file.first.c_str());
+      if(!read_file.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open file \"" + file.first + "\"!");
+      const std::string buffer = {std::istreambuf_iterator<char>(read_file), std::istreambuf_iterator<char>{}};
+      served = client.map(file.first, buffer, script, mapped, error);
+      if(!served && client.connected()) cmd_line_error(__func__, __LINE__, error); // the daemon's mapping failed
+    }
+    if(!served) {
+      DEF_MAC::Script(script).map_file(file.first, file.second);
+    } else if(!script.write_if_changed || !DEF_MAC::file_holds(file.second, {mapped})) {
+      std::ofstream write_file(file.second.c_str());
+      if(!write_file.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open file \"" + file.second + "\"!");
+      write_file << mapped;
+      write_file.close();
+      if(!write_file) cmd_line_error(__func__, __LINE__, "couldn't write file \"" + file.second + "\"!");
+    }
+    if(i < file_seconds.size()) file_seconds[i] = DEF_MAC::MacroProfile::seconds_since(start);
+  }
 }
 
 /******************************************************************************
 * MAIN EXECUTION
 ******************************************************************************/
 
+// "DEFMAC_NO_MAIN" lets other programs #include this file (ie defmac_bench.cpp)
+#ifndef DEFMAC_NO_MAIN
 int main(int argc, char **argv) {
-  bool show_info = false;
-  std::string parse_filename, write_filename;
-  confirm_valid_cmd_line_input(argc,argv,show_info,parse_filename,write_filename);
+  CmdLineOptions options;
+  confirm_valid_cmd_line_input(argc,argv,options);
+  const std::string &parse_filename = options.parse_filename, &write_filename = options.write_filename;
 
-  DEF_MAC::Script yourScript;       // DEF_MAC::Script object to map a file
-  yourScript.show_info = show_info; // show_info flag for mapping in "yourScript"
+  DEF_MAC::Script yourScript;               // DEF_MAC::Script object to map a file
+  yourScript.show_info = options.show_info; // show_info flag for mapping in "yourScript"
+  yourScript.code_only = options.code_only; // leave comments & literals untouched
+  yourScript.map_threads = options.jobs;    // map 1 big file's lines across threads
+  yourScript.write_if_changed = options.write_if_changed; // keep unchanged outputs' mtimes
+  yourScript.match_step_budget = options.max_steps;       // skip runaway match attempts
+  yourScript.file_time_budget = options.max_seconds;      // fail files mapping for too long
+  if(options.max_match_span)                // bound multi-line matches when streaming
+    yourScript.max_match_span = options.max_match_span;
+  if(options.cache_macros)                  // reuse compiled "#defmac_include" files
+    yourScript.macro_cache_dir = DEF_MAC::Script::default_macro_cache_dir();
+  if(options.profile)                       // time each alias (shared by batch workers)
+    yourScript.profile = std::make_shared<DEF_MAC::MacroProfile>();
 
   // Register Custom Regex (more direct control then #defmac macro) 
   //     To "yourScript"s Parser, (C++ : Custom_syntax)
@@ -533,7 +4053,51 @@ int main(int argc, char **argv) {
   // Map File & Cluster Its Headers (triggered by last "true" flag passed)
   // yourScript.map_file(parse_filename, write_filename, true);
 
-  yourScript.map_file(parse_filename, write_filename);
+  // Serve Mapping Requests Forever, Keeping Compiled "#defmac_include"s Resident
+  if(options.serve) DEF_MAC::serve(yourScript, DEF_MAC::default_socket_path());
+
+  // Re-Map The File On Every Save Forever, Re-Mapping Only Its Edited Lines
+  if(options.watch) DEF_MAC::watch(yourScript, parse_filename, write_filename);
+
+  // Map A Batch: Macro Sets Compiled Once & Shared, Files Mapped Across All Cores
+  for(auto &file : options.batch) {
+    std::error_code ec;
+    const auto write_directory = std::filesystem::path(file.second).parent_path();
+    if(!write_directory.empty()) std::filesystem::create_directories(write_directory, ec);
+  }
+  auto depend_on = [&options](DEF_MAC::Script &script, const std::string &output_filename) {
+    if(!options.write_dependencies) return; // "-MF"'s file, else the output's w/ a ".d" extension
+    script.dependency_file = !options.dependency_filename.empty() ? options.dependency_filename 
+                           : std::filesystem::path(output_filename).replace_extension(".d").string();
+  };
+  std::vector<double> file_seconds; // each batch file's mapping time (if mapped here: for its p50/p99)
+  auto map_one = [&options,&depend_on](DEF_MAC::Script &script, const std::string &read_filename, const std::string &write_filename) {
+    depend_on(script, write_filename.empty() ? read_filename : write_filename);
+    if(options.stream) script.stream_file(read_filename, write_filename);
+    else               script.map_file(read_filename, write_filename);
+  };
+  if(options.emit_matcher) {
+    depend_on(yourScript, write_filename);
+    if(!yourScript.emit_matcher(parse_filename, write_filename))
+      cmd_line_error(__func__, __LINE__, "No #defmac Macros To Emit In \"" + parse_filename + "\"!");
+  } else if(options.client && !options.show_info && !options.stream && !options.profile && !options.write_dependencies) { // (local only)
+    auto files = options.batch;
+    if(files.empty()) files.emplace_back(parse_filename, write_filename.empty() ? parse_filename : write_filename);
+    file_seconds.resize(options.batch.size());
+    map_files_via_server(yourScript, files, file_seconds);
+  } else if(!options.batch.empty()) {
+    yourScript.share_macro_sets();
+    file_seconds.resize(options.batch.size());
+    DEF_MAC::WorkStealingPool::run(options.batch.size(), options.jobs, [&](std::size_t i) {
+      DEF_MAC::Script fileScript(yourScript); // cheap copy: shares compiled "#defmac_include" sets
+      fileScript.map_threads = 1;             // (the pool's threads already fill every core)
+      const auto start = DEF_MAC::MacroProfile::Clock::now();
+      map_one(fileScript, options.batch[i].first, options.batch[i].second);
+      file_seconds[i] = DEF_MAC::MacroProfile::seconds_since(start);
+    });
+  } else {
+    map_one(yourScript, parse_filename, write_filename);
+  }
 
   std::cout << std::endl << "\033[1m"
             << R"(        __      __   ______  __     ____    _____   ______  _____  ____         )" << std::endl
@@ -544,10 +4108,40 @@ int main(int argc, char **argv) {
             << R"(       |    /( (_/)_/ /_/ / _/ // / / ((   \_) )_\  \_) )/   ) /   )            )" << std::endl
             << R"(       (___/  \__/(__/(___)(___)\_)(___)\_____/(_)\____/(___/ (___/             )" << "\033[0m\n\n";
 
-  if(!write_filename.empty())
+  if(!options.batch.empty()) {
+    for(auto &file : options.batch)
+      if(file.first != file.second)
+        std::cout << "\033[1m -:- " << file.first << " ==PARSED=MAPPED=> " << file.second << " -:-\033[0m\n";
+      else
+        std::cout << "\033[1m -:- " << file.first << " LOCALLY EDITED! -:-\033[0m\n";
+    std::cout << "\033[1m -:- " << options.batch.size() << " FILES MAPPED! -:-\033[0m\n";
+    if(!file_seconds.empty()) { // tail latency: nearest-rank percentiles
+      std::vector<std::size_t> order(file_seconds.size());
+      for(std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+      std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {return file_seconds[a] < file_seconds[b];});
+      auto percentile = [&](std::size_t pct) {return file_seconds[order[(pct * order.size() + 99) / 100 - 1]] * 1e3;};
+      std::ostringstream latency;
+      latency << std::fixed << std::setprecision(2) << " -:- per-file mapping ms: p50 " << percentile(50) 
+              << ", p99 " << percentile(99) << ", max " << file_seconds[order.back()] * 1e3 
+              << " (" << options.batch[order.back()].first << ") -:-\n";
+      std::cout << latency.str();
+    }
+    std::cout << '\n';
+  } else if(options.emit_matcher)
+    std::cout << "\033[1m -:- " << parse_filename << " ==PARSED=EMITTED=> " << write_filename << " -:-\033[0m\n\n";
+  else if(!write_filename.empty())
     std::cout << "\033[1m -:- " << parse_filename << " ==PARSED=MAPPED=> " << write_filename << " -:-\033[0m\n\n";
   else
     std::cout << "\033[1m -:- " << parse_filename << " LOCALLY EDITED! -:-\033[0m\n\n";
 
+  if(options.profile && options.profile_json.empty()) {
+    yourScript.profile->report(std::cout);
+    std::cout << std::endl;
+  } else if(options.profile) {
+    std::ofstream profile_file(options.profile_json.c_str());
+    if(!profile_file.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open file \"" + options.profile_json + "\"!");
+    yourScript.profile->report_json(profile_file);
+  }
   return 0;
 }
+#endif
@@ -0,0 +1,436 @@
+// Author: Jordan Randleman -- defmac_bench.cpp -- defmac.cpp's throughput benchmarks
+//   => g++ -std=c++17 -O2 -pthread -o defmac_bench defmac_bench.cpp
+//   => ./defmac_bench [-size MB] [-macros N] [-density D] [-line N] [-reps N]
+//                     [-seed N] [-stage NAME] [-corpus DIR] [-compile N] [-threads N]
+//   => prints 1 JSON object per line: the corpus, then each timed stage
+//      (search stages once per SIMD width: "$DEFMAC_SIMD=sse2" caps it)
+#define DEFMAC_NO_MAIN
+#define DEFMAC_COUNT_ALLOCATIONS
+#include "defmac.cpp"
+#ifdef DEFMAC_POSIX
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+/******************************************************************************
+* SYNTHETIC CORPUS GENERATOR
+******************************************************************************/
+
+namespace DEF_MAC_BENCH {
+  using std::string;
+
+  struct CorpusSpec {
+    std::size_t   bytes = 8 << 20;     // approximate body size
+    std::size_t   macros = 16;         // # of distinct "#defmac" directives
+    double        density = 0.05;      // fraction of lines holding a macro use
+    std::size_t   line_length = 60;    // mean filler line length
+    std::uint64_t seed = 1;
+  };
+
+  struct Corpus {
+    string      directives; // the "#defmac" lines (also atop "text")
+    string      text;       // directives + body: a self-contained file
+    std::size_t sites = 0;  // macro uses planted == matches a full map makes
+    std::size_t lines = 0;
+  };
+
+  // Macro styles from defmac_sampleExec.cpp & defmac_macros.dmac: '%' in a
+  // syntax becomes the macro's #, so N macros of 1 style never match each other
+  struct MacroStyle {
+    const char *syntax, *replacement;
+    string (*use)(std::mt19937_64 &rng, std::size_t n, const string &tag);
+  };
+
+  string tagged(const char *s, const string &tag) {
+    string out;
+    for(; *s; ++s) if(*s == '%') out += tag; else out += *s;
+    return out;
+  }
+
+  const MacroStyle styles[] = {
+    {"$var :=% $val", "auto $var = $val;",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       return "  v" + std::to_string(n) + " :=" + tag + " " + std::to_string(rng() % 1000);
+     }},
+    {"$var = $res1 if% $condition else $res2;", "$var = ($condition) ? $res1 : $res2;",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       return "  int x" + std::to_string(n) + " = " + std::to_string(rng() % 100) + " if" + tag
+            + " " + std::to_string(rng() % 100) + " > a" + std::to_string(n % 97) + " else 9;";
+     }},
+    {"$lambda = ($args) =%> $operation;", "auto $lambda = []($<auto>args){return $operation;};",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       return "  f" + std::to_string(n) + " = (x, y) =" + tag + "> x * y + " + std::to_string(rng() % 10) + ";";
+     }},
+    {"$type $var = [%];", "std::vector<$type>$var;",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       static const char *types[] = {"int", "double", "long", "char"};
+       return string("  ") + types[rng() % 4] + " vec" + std::to_string(n) + " = [" + tag + "];";
+     }},
+    {"$container.map%($elt => $operation);", "for(auto &$elt : $container) $elt = $operation;",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       return "  arr" + std::to_string(n % 31) + ".map" + tag + "(e => e * " + std::to_string(1 + rng() % 9) + ");";
+     }},
+    {"loop% $var : [$start,$end]", "for(auto $var = $start; $var <= $end; ++$var)",
+     [](std::mt19937_64 &rng, std::size_t n, const string &tag) {
+       return "  loop" + tag + " i : [0," + std::to_string(rng() % 64) + "] sum += i * " + std::to_string(n % 7) + ";";
+     }},
+    {"$base **% $exp", "std::pow($base, $exp)",
+     [](std::mt19937_64 &rng, std::size_t, const string &tag) {
+       return "  cout << " + std::to_string(rng() % 10) + " **" + tag + " " + std::to_string(rng() % 10) + " << endl;";
+     }},
+  };
+  constexpr std::size_t style_count = sizeof(styles) / sizeof(styles[0]);
+
+  // Plain C++ w/ comments, literals, & the odd #include (for header clustering)
+  string filler_line(std::mt19937_64 &rng, std::size_t n, std::size_t length) {
+    static const char *includes[] = {"#include <vector>", "#include <map>", "#include \"util.hpp\"", "#include <cmath>"};
+    string line;
+    switch(rng() % 8) {
+      case 0:  line = "  // note " + std::to_string(n) + ":"; break;
+      case 1:  line = "  std::string s" + std::to_string(n) + " = \"text " + std::to_string(rng() % 1000) + "\";"; break;
+      case 2:  line = "  if(a" + std::to_string(n % 97) + " > " + std::to_string(rng() % 50) + ") {"; break;
+      case 3:  line = "  }"; break;
+      default: line = "  int id" + std::to_string(n) + " = id" + std::to_string(rng() % (n + 1)) + " + " + std::to_string(rng() % 100) + ";";
+    }
+    if(rng() % 1000 == 0) return includes[rng() % 4];
+    const std::size_t target = length / 2 + rng() % (length + 1); // mean ~= length
+    if(line.size() + 4 < target) {
+      line += " // ";
+      while(line.size() < target) line += static_cast<char>('a' + rng() % 26);
+    }
+    return line;
+  }
+
+  // "count" distinct "#defmac" directives, 1 per line
+  std::vector<string> macro_set(std::size_t count) {
+    std::vector<string> directives;
+    for(std::size_t i = 0; i < count; ++i) {
+      const MacroStyle &style = styles[i % style_count];
+      directives.push_back("#defmac `" + tagged(style.syntax, std::to_string(i)) + '`' + style.replacement + "`\n");
+    }
+    return directives;
+  }
+
+  // "body" w/ "directives" spread evenly between its lines
+  string scatter_directives(const string &body, const std::vector<string> &directives) {
+    const std::size_t lines = std::count(body.begin(), body.end(), '\n'), every = lines / (directives.size() + 1) + 1;
+    string scattered;
+    scattered.reserve(body.size() + directives.size() * 64);
+    std::size_t line = 0, placed = 0;
+    for(std::size_t p = 0; p < body.size();) {
+      const std::size_t end = std::min(body.find('\n', p), body.size() - 1) + 1;
+      scattered.append(body, p, end - p);
+      if(++line % every == 0 && placed < directives.size()) scattered += directives[placed++];
+      p = end;
+    }
+    while(placed < directives.size()) scattered += directives[placed++];
+    return scattered;
+  }
+
+  Corpus generate_corpus(const CorpusSpec &spec) {
+    Corpus corpus;
+    std::mt19937_64 rng(spec.seed);
+    for(auto &directive : macro_set(spec.macros)) corpus.directives += directive;
+    corpus.text = "#include <iostream>\n#include <cmath>\n" + corpus.directives + "\nint main() {\n";
+    corpus.text.reserve(spec.bytes + spec.bytes / 8);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for(std::size_t n = 0; corpus.text.size() < spec.bytes; ++n, ++corpus.lines) {
+      if(spec.macros && unit(rng) < spec.density) {
+        const std::size_t i = rng() % spec.macros;
+        corpus.text += styles[i % style_count].use(rng, n, std::to_string(i));
+        ++corpus.sites;
+      } else {
+        corpus.text += filler_line(rng, n, spec.line_length);
+      }
+      corpus.text += '\n';
+    }
+    corpus.text += "  return 0;\n}\n";
+    return corpus;
+  }
+
+/******************************************************************************
+* STAGE TIMING & REPORTING
+******************************************************************************/
+
+  // Peak resident set size in KB (0 if unknown)
+  long peak_rss_kb() {
+#ifdef DEFMAC_POSIX
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+  }
+
+  struct StageResult {
+    string      stage;
+    std::size_t bytes = 0, matches = 0, reps = 0;
+    double      median = 0, best = 0; // seconds
+    long        rss_kb = 0;
+    std::uint64_t allocations = 0;    // heap allocations per run (this thread's)
+  };
+
+  // Time "run" (after an untimed warm-up) "reps" times: "setup" runs untimed before each
+  StageResult time_stage(const string &stage, std::size_t bytes, std::size_t matches, std::size_t reps,
+                         const std::function<void()> &setup, const std::function<void()> &run) {
+    std::vector<double> seconds;
+    std::uint64_t allocations = 0;
+    for(std::size_t i = 0; i <= reps; ++i) {
+      setup();
+      const std::uint64_t allocations_before = DEF_MAC::thread_allocations();
+      const auto start = std::chrono::steady_clock::now();
+      run();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if(i) seconds.push_back(elapsed.count()), allocations += DEF_MAC::thread_allocations() - allocations_before;
+    }
+    std::sort(seconds.begin(), seconds.end());
+    StageResult result;
+    result.stage = stage, result.bytes = bytes, result.matches = matches, result.reps = reps;
+    result.median = seconds[seconds.size() / 2], result.best = seconds.front();
+    result.rss_kb = peak_rss_kb();
+    result.allocations = allocations / reps;
+    return result;
+  }
+
+  string json_number(double d) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.6g", d);
+    return buf;
+  }
+
+  string to_json(const StageResult &r) {
+    const double mb = r.bytes / (1024.0 * 1024.0);
+    return "{\"stage\":\"" + r.stage + "\",\"bytes\":" + std::to_string(r.bytes)
+         + ",\"reps\":" + std::to_string(r.reps) + ",\"seconds\":" + json_number(r.median)
+         + ",\"best_seconds\":" + json_number(r.best) + ",\"mb_per_s\":" + json_number(r.median ? mb / r.median : 0)
+         + ",\"matches\":" + std::to_string(r.matches)
+         + ",\"matches_per_s\":" + json_number(r.median ? r.matches / r.median : 0)
+         + ",\"allocations\":" + std::to_string(r.allocations)
+         + ",\"allocations_per_match\":" + json_number(r.matches ? double(r.allocations) / r.matches : 0)
+         + ",\"peak_rss_kb\":" + std::to_string(r.rss_kb) + "}";
+  }
+
+  // Run 1 stage & print its JSON line: on POSIX in a child process, so each
+  // stage's peak RSS is its own (the corpus + what the stage allocates)
+  void report_stage(const std::function<StageResult()> &stage) {
+#ifdef DEFMAC_POSIX
+    std::cout.flush();
+    const pid_t pid = fork();
+    if(pid == 0) {
+      std::cout << to_json(stage()) << std::endl;
+      std::_Exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    if(pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+      cmd_line_error(__func__, __LINE__, "benchmark stage failed!");
+#else
+    std::cout << to_json(stage()) << std::endl;
+#endif
+  }
+};   // end of namespace DEF_MAC_BENCH
+
+/******************************************************************************
+* MAIN EXECUTION
+******************************************************************************/
+
+int main(int argc, char **argv) {
+  using namespace DEF_MAC_BENCH;
+  CorpusSpec spec;
+  std::size_t reps = 3, compiled_macros = 512; // (# of "#defmac"s the compile stages parse)
+  unsigned threads = std::max(2u, std::thread::hardware_concurrency()); // (the parallel "apply_aliases"'s)
+  std::string only_stage, corpus_dir;
+
+  // Parse cmd-line flags: each takes 1 value
+  for(int i = 1; i < argc; i += 2) {
+    const std::string flag = argv[i];
+    if(i + 1 == argc) cmd_line_error(__func__, __LINE__, "flag \"" + flag + "\" is missing its value!");
+    const std::string value = argv[i+1];
+    try {
+      if(flag == "-size")         spec.bytes = static_cast<std::size_t>(std::stod(value) * 1024 * 1024);
+      else if(flag == "-macros")  spec.macros = std::stoul(value);
+      else if(flag == "-density") spec.density = std::stod(value);
+      else if(flag == "-line")    spec.line_length = std::stoul(value);
+      else if(flag == "-reps")    reps = std::stoul(value);
+      else if(flag == "-seed")    spec.seed = std::stoull(value);
+      else if(flag == "-stage")   only_stage = value;
+      else if(flag == "-corpus")  corpus_dir = value;
+      else if(flag == "-compile") compiled_macros = std::stoul(value);
+      else if(flag == "-threads") threads = unsigned(std::stoul(value));
+      else cmd_line_error(__func__, __LINE__, "unknown flag \"" + flag + "\"!");
+    } catch(const std::logic_error &) {
+      cmd_line_error(__func__, __LINE__, "invalid value \"" + value + "\" for flag \"" + flag + "\"!");
+    }
+  }
+  if(!reps) reps = 1;
+
+  const Corpus corpus = generate_corpus(spec);
+  std::cout << "{\"corpus\":{\"bytes\":" << corpus.text.size() << ",\"lines\":" << corpus.lines
+            << ",\"macros\":" << spec.macros << ",\"density\":" << json_number(spec.density)
+            << ",\"line_length\":" << spec.line_length << ",\"sites\":" << corpus.sites
+            << ",\"seed\":" << spec.seed << "}}" << std::endl;
+
+  // Only write the corpus (ie to profile the "defmac" binary itself)
+  if(!corpus_dir.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(corpus_dir, ec);
+    const std::string filename = (std::filesystem::path(corpus_dir) / "bench_corpus.cpp").string();
+    std::ofstream out(filename, std::ios::binary);
+    if(!out.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open file \"" + filename + "\"!");
+    out << corpus.text;
+    return 0;
+  }
+  auto wanted = [&only_stage](const char *stage) {return only_stage.empty() || only_stage == stage;};
+
+  // "#defmac" directives -> compiled alias programs
+  if(wanted("parse_defmac_macros")) report_stage([&] {
+    std::string buffer;
+    return time_stage("parse_defmac_macros", corpus.directives.size(), 0, reps, [&]{buffer = corpus.directives;}, [&] {
+      DEF_MAC::Script script;
+      script.parse_defmac_macros(buffer);
+    });
+  });
+
+  // A big macro set compiled alone ("matches" == macros compiled), then spread
+  // through the corpus body (cutting directives out of a big file)
+  if(wanted("compile_macros") || wanted("compile_macros:scattered")) {
+    const std::vector<std::string> directives = macro_set(compiled_macros);
+    std::string alone, buffer;
+    for(auto &directive : directives) alone += directive;
+    const std::string scattered = scatter_directives(corpus.text.substr(corpus.directives.size()), directives);
+    for(auto [stage, text] : {std::pair<const char *,const std::string *>{"compile_macros", &alone}, {"compile_macros:scattered", &scattered}})
+      if(wanted(stage)) report_stage([&] {
+        return time_stage(stage, text->size(), directives.size(), reps, [&]{buffer = *text;}, [&] {
+          DEF_MAC::Script script;
+          script.parse_defmac_macros(buffer);
+        });
+      });
+  }
+
+  // Searches at each vector width this CPU runs ("scalar" == std::string_view's
+  // finds, as they ran before): "#defmac" & a defn's end ('`' or '\r') as the
+  // directive parser looks for them, & the corpus macros' anchors as "map_buffer" does
+  if(wanted("find_literal") || wanted("find_bytes") || wanted("find_anchors")) {
+    const std::string_view text = corpus.text;
+    const DEF_MAC::ByteSet defn_ends("`\r");
+    DEF_MAC::AnchorSet anchors;
+    for(std::size_t i = 0; i < spec.macros; ++i) {
+      const auto program = DEF_MAC::MacroProgram::compile(tagged(styles[i % style_count].syntax, std::to_string(i)));
+      if(program.anchor()) anchors.add(*program.anchor());
+    }
+    anchors.build();
+    auto count_literal = [&] {
+      std::size_t hits = 0;
+      for(std::size_t p = DEF_MAC::find_literal(text, "#defmac"); p != std::string_view::npos; p = DEF_MAC::find_literal(text, "#defmac", p+1)) ++hits;
+      return hits;
+    };
+    auto count_bytes = [&] {
+      std::size_t hits = 0;
+      for(std::size_t p = defn_ends.find(text); p != std::string_view::npos; p = defn_ends.find(text, p+1)) ++hits;
+      return hits;
+    };
+    auto count_anchors = [&] {
+      std::size_t hits = 0;
+      anchors.scan(text, 0, text.size(), [&hits](unsigned, std::size_t) {++hits;});
+      return hits;
+    };
+    const DEF_MAC::SimdLevel widest = DEF_MAC::simd_level();
+    for(unsigned level = 0; level <= unsigned(widest); ++level) {
+      DEF_MAC::simd_level() = DEF_MAC::SimdLevel(level);
+      const string width = DEF_MAC::simd_level_name(DEF_MAC::SimdLevel(level));
+      std::size_t hits = 0;
+      if(wanted("find_literal")) report_stage([&] {
+        return time_stage("find_literal:" + width, text.size(), count_literal(), reps, []{}, [&] {hits += count_literal();});
+      });
+      if(wanted("find_bytes")) report_stage([&] {
+        return time_stage("find_bytes:" + width, text.size(), count_bytes(), reps, []{}, [&] {hits += count_bytes();});
+      });
+      if(wanted("find_anchors")) report_stage([&] {
+        return time_stage("find_anchors:" + width, text.size(), count_anchors(), reps, []{}, [&] {hits += count_anchors();});
+      });
+    }
+    DEF_MAC::simd_level() = widest;
+    if(wanted("find_bytes")) report_stage([&] { // (what the directive parser ran before "ByteSet")
+      std::size_t hits = 0;
+      auto count_first_of = [&] {
+        std::size_t found = 0;
+        for(std::size_t p = text.find_first_of("`\r"); p != std::string_view::npos; p = text.find_first_of("`\r", p+1)) ++found;
+        return found;
+      };
+      return time_stage("find_bytes:find_first_of", text.size(), count_first_of(), reps, []{}, [&] {hits += count_first_of();});
+    });
+  }
+
+  // Whole file in memory: directives parsed, then every alias applied
+  std::string mapped;
+  if(wanted("cluster_buffer_headers")) mapped = DEF_MAC::Script().map_buffer(corpus.text);
+  if(wanted("map_buffer")) report_stage([&] {
+    return time_stage("map_buffer", corpus.text.size(), corpus.sites, reps, []{}, [&] {
+      DEF_MAC::Script().map_buffer(corpus.text);
+    });
+  });
+
+  // The same, warm: 1 Script's aliases re-applied to the directive-free body on
+  // 1 thread, reusing its scratch buffers & built matchers (per-match heap traffic)
+  if(wanted("apply_aliases")) report_stage([&] {
+    DEF_MAC::Script script;
+    script.map_threads = 1;
+    std::string body = corpus.text, buffer;
+    script.parse_defmac_macros(body);
+    return time_stage("apply_aliases", body.size(), corpus.sites, reps, [&]{buffer = body;}, [&] {
+      script.apply_aliases(buffer);
+    });
+  });
+
+  // The same on "-threads" threads (chunks of lines mapped concurrently): the
+  // stage fails unless its output is byte-identical to mapping on 1 thread
+  if(wanted("apply_aliases:threads")) report_stage([&] {
+    DEF_MAC::Script serial, parallel;
+    serial.map_threads = 1, parallel.map_threads = threads;
+    std::string expected = corpus.text, body = corpus.text, buffer;
+    serial.parse_defmac_macros(expected);
+    parallel.parse_defmac_macros(body);
+    serial.apply_aliases(expected);
+    StageResult result = time_stage("apply_aliases:threads", body.size(), corpus.sites, reps, [&]{buffer = body;}, [&] {
+      parallel.apply_aliases(buffer);
+    });
+    if(buffer != expected) {
+      const std::size_t at = std::size_t(std::mismatch(buffer.begin(), buffer.begin() + std::min(buffer.size(), expected.size()), expected.begin()).first - buffer.begin());
+      cmd_line_error(__func__, __LINE__, "apply_aliases on " + std::to_string(threads) + " threads differs from 1 thread at byte " + std::to_string(at) + "!");
+    }
+    return result;
+  });
+
+  // Hoisting the mapped file's #include's
+  if(wanted("cluster_buffer_headers")) report_stage([&] {
+    return time_stage("cluster_buffer_headers", mapped.size(), 0, reps, []{}, [&] {
+      DEF_MAC::Script().cluster_buffer_headers(mapped);
+    });
+  });
+
+  // File to file, as the "defmac" binary runs (mmap fast path on POSIX)
+  if(wanted("map_file")) {
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string token = std::to_string(std::random_device{}());
+    const std::string read_filename  = (dir / ("defmac_bench_" + token + ".cpp")).string();
+    const std::string write_filename = (dir / ("defmac_bench_" + token + "_DMAC.cpp")).string();
+    {
+      std::ofstream out(read_filename, std::ios::binary);
+      if(!out.is_open()) cmd_line_error(__func__, __LINE__, "couldn't open file \"" + read_filename + "\"!");
+      out << corpus.text;
+    }
+    report_stage([&] {
+      return time_stage("map_file", corpus.text.size(), corpus.sites, reps, []{}, [&] {
+        DEF_MAC::Script().map_file(read_filename, write_filename);
+      });
+    });
+    std::error_code ec;
+    std::filesystem::remove(read_filename, ec);
+    std::filesystem::remove(write_filename, ec);
+  }
+  return 0;
+}